@@ -1,12 +1,39 @@
+#include <algorithm>
+#include <atomic>
 #include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <typeindex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 /*
 Dependency Inversion Principle (DIP) is a crucial design principle that promotes loose
 coupling and code maintainability. It advocates for high-level modules to depend on
@@ -48,6 +75,30 @@ struct Person
     std::string_view name;
 };
 
+/**
+ * A non-owning reference to a callable taking a Person, used to visit query results without
+ * allocating. It must not outlive the callable it refers to.
+ */
+class PersonVisitor
+{
+    void *object;
+    void (*call)(void *, Person &);
+
+  public:
+    template <typename F>
+        requires std::invocable<F &, Person &> && (!std::same_as<std::remove_cvref_t<F>, PersonVisitor>)
+    PersonVisitor(F &&f)
+        : object(const_cast<void *>(static_cast<const void *>(std::addressof(f)))),
+          call([](void *o, Person &p) { (*static_cast<std::remove_reference_t<F> *>(o))(p); })
+    {
+    }
+
+    void operator()(Person &person) const
+    {
+        call(object, person);
+    }
+};
+
 /**
  * An interface for classes that can browse relationships between people.
  */
@@ -61,24 +112,226 @@ class RelationshipBrowser
      * @return A vector of pointers to the children of the given person.
      */
     virtual std::vector<Person *> findAllChildrenOf(const std::string_view &name) = 0;
+
+    /**
+     * Calls `visit` with each child of the person with the given name.
+     *
+     * The default implementation goes through findAllChildrenOf(); implementations that can walk
+     * their storage directly override it so that a query allocates nothing.
+     *
+     * @param name The name of the person whose children should be visited.
+     * @param visit Called once per child.
+     */
+    virtual void forEachChildOf(const std::string_view &name, PersonVisitor visit)
+    {
+        for (Person *child : findAllChildrenOf(name))
+        {
+            visit(*child);
+        }
+    }
+
+    /**
+     * Writes pointers to the children of the person with the given name into a caller-provided
+     * buffer.
+     *
+     * @param name The name of the person whose children should be found.
+     * @param out Receives the first out.size() children.
+     * @return The total number of children, which may exceed out.size().
+     */
+    std::size_t copyChildrenOf(const std::string_view &name, std::span<Person *> out)
+    {
+        std::size_t count = 0;
+        forEachChildOf(name, [&](Person &child) {
+            if (count < out.size())
+            {
+                out[count] = &child;
+            }
+            ++count;
+        });
+        return count;
+    }
+
+    /**
+     * Returns a vector of pointers to all the parents of the person with the given name.
+     *
+     * @param name The name of the person whose parents should be found.
+     * @return A vector of pointers to the parents of the given person.
+     */
+    virtual std::vector<Person *> findAllParentsOf(const std::string_view &name) = 0;
+
+    /**
+     * A depth limit that does not limit anything.
+     */
+    static constexpr std::size_t anyDepth = std::numeric_limits<std::size_t>::max();
+
+    /**
+     * Returns the children, grandchildren and so on of the person with the given name, nearest
+     * generations first, each person once.
+     *
+     * The default implementation walks findAllChildrenOf() one name at a time; implementations
+     * with a faster traversal override it.
+     *
+     * @param name The name of the person whose descendants should be found.
+     * @param maxDepth How many generations to go down; 1 returns only the children.
+     * @return A vector of pointers to the descendants of the given person.
+     */
+    virtual std::vector<Person *> findAllDescendantsOf(const std::string_view &name, std::size_t maxDepth = anyDepth)
+    {
+        return walk(name, maxDepth, [this](std::string_view n) { return findAllChildrenOf(n); });
+    }
+
+    /**
+     * Returns the parents, grandparents and so on of the person with the given name, nearest
+     * generations first, each person once.
+     *
+     * @param name The name of the person whose ancestors should be found.
+     * @param maxDepth How many generations to go up; 1 returns only the parents.
+     * @return A vector of pointers to the ancestors of the given person.
+     */
+    virtual std::vector<Person *> findAllAncestorsOf(const std::string_view &name, std::size_t maxDepth = anyDepth)
+    {
+        return walk(name, maxDepth, [this](std::string_view n) { return findAllParentsOf(n); });
+    }
+
+    /**
+     * Returns the siblings of the person with the given name: everyone else who shares at least
+     * one parent with them, each person once.
+     *
+     * Siblings are not stored as Relationship::sibling edges, which would grow quadratically with
+     * family size; they are derived from the parents' children on every call.
+     *
+     * @param name The name of the person whose siblings should be found.
+     * @return A vector of pointers to the siblings of the given person.
+     */
+    virtual std::vector<Person *> findAllSiblingsOf(const std::string_view &name)
+    {
+        std::vector<Person *> result;
+        for (Person *parent : findAllParentsOf(name))
+        {
+            for (Person *child : findAllChildrenOf(parent->name))
+            {
+                if (child->name != name)
+                {
+                    result.push_back(child);
+                }
+            }
+        }
+
+        // A sibling sharing both parents is found twice; keep the first pointer for each name.
+        std::stable_sort(result.begin(), result.end(), [](Person *a, Person *b) { return a->name < b->name; });
+        result.erase(std::unique(result.begin(), result.end(), [](Person *a, Person *b) { return a->name == b->name; }),
+                     result.end());
+        return result;
+    }
+
+    /**
+     * Returns a number that changes whenever the answers of this browser may have changed.
+     *
+     * Callers that keep results around (such as CachingRelationshipBrowser) compare it with the
+     * value they saw when they made the query. The default suits browsers that never change.
+     */
+    virtual std::uint64_t version()
+    {
+        return 0;
+    }
+
+    virtual ~RelationshipBrowser() = default;
+
+  private:
+    /**
+     * Breadth-first walk from `name`, expanding each person with `next`.
+     */
+    template <typename Next> static std::vector<Person *> walk(std::string_view name, std::size_t maxDepth, Next next)
+    {
+        std::vector<Person *> result;
+        std::unordered_set<std::string_view> seen{name};
+        std::vector<std::string_view> frontier{name};
+
+        for (std::size_t depth = 0; depth < maxDepth && !frontier.empty(); ++depth)
+        {
+            std::vector<std::string_view> following;
+            for (auto current : frontier)
+            {
+                for (Person *relative : next(current))
+                {
+                    if (seen.insert(relative->name).second)
+                    {
+                        result.push_back(relative);
+                        following.push_back(relative->name);
+                    }
+                }
+            }
+            frontier = std::move(following);
+        }
+        return result;
+    }
 };
 
 // low-level module - what it does it is provides functionality for data storage.
 // we have this vector of tuples and it has a couple of utility functions for actually populating that
 // storage.
 
+/**
+ * How Relationships stores a parent-child pair.
+ */
+enum class StorageMode
+{
+    bothDirections, // a parent tuple and a child tuple per pair
+    singleEdge      // only the parent tuple; parents are found through a reverse index
+};
+
 /**
  * A concrete implementation of the RelationshipBrowser interface that stores relationships
  * in a vector of tuples.
  */
 class Relationships : public RelationshipBrowser
 {
+    StorageMode mode = StorageMode::bothDirections;
+
+    /**
+     * In singleEdge mode: the positions in `relations` of the parent tuples of each child, keyed by
+     * the child's name. Built on the first parent query (or by buildReverseIndex()) and kept up to
+     * date from then on. The lazy build happens under `reverseIndexLock`, so concurrent read-only
+     * queries stay safe.
+     */
+    std::unordered_map<std::string_view, std::vector<std::size_t>> reverseIndex;
+    std::atomic<bool> reverseIndexBuilt{false};
+    std::mutex reverseIndexLock;
+
+    void indexParents()
+    {
+        reverseIndex.clear();
+        for (std::size_t i = 0; i < relations.size(); ++i)
+        {
+            auto &[first, rel, second] = relations[i];
+            if (rel == Relationship::parent)
+            {
+                reverseIndex[second.name].push_back(i);
+            }
+        }
+        reverseIndexBuilt.store(true, std::memory_order_release);
+    }
+
   public:
+    Relationships() = default;
+
+    /**
+     * @param mode Whether to store each pair in both directions or once.
+     */
+    explicit Relationships(StorageMode mode) : mode(mode)
+    {
+    }
+
     /**
      * A vector of tuples representing the relationships between people.
      */
     std::vector<std::tuple<Person, Relationship, Person>> relations;
 
+    /**
+     * Counts the calls to addParentAndChild(); code that edits `relations` directly should bump it.
+     */
+    std::uint64_t changes = 0;
+
     /**
      * Adds a parent-child relationship between the given parents and child.
      *
@@ -88,7 +341,35 @@ class Relationships : public RelationshipBrowser
     void addParentAndChild(const Person &parent, const Person &child)
     {
         relations.push_back({parent, Relationship::parent, child});
-        relations.push_back({child, Relationship::child, parent});
+        if (mode == StorageMode::bothDirections)
+        {
+            relations.push_back({child, Relationship::child, parent});
+        }
+        else if (reverseIndexBuilt.load(std::memory_order_relaxed))
+        {
+            reverseIndex[child.name].push_back(relations.size() - 1);
+        }
+        ++changes;
+    }
+
+    /**
+     * Builds the reverse (child to parents) index of singleEdge mode in one pass, for example
+     * right after a bulk import, instead of on the first parent query.
+     */
+    void buildReverseIndex()
+    {
+        std::lock_guard guard{reverseIndexLock};
+        indexParents();
+    }
+
+    /**
+     * Overrides the version() method of the RelationshipBrowser interface.
+     *
+     * @return The number of relationships added through addParentAndChild().
+     */
+    std::uint64_t version() override
+    {
+        return changes;
     }
 
     /**
@@ -112,65 +393,3194 @@ class Relationships : public RelationshipBrowser
         }
         return result;
     }
-};
 
-// High-level module
-class Research
-{
-  public:
-    // Constructor - Accepts a `RelationshipBrowser` object to access the relationships
-    Research(RelationshipBrowser &browser, std::string_view name)
+    /**
+     * Overrides the forEachChildOf() method of the RelationshipBrowser interface.
+     *
+     * @param name The name of the person whose children should be visited.
+     * @param visit Called once per child.
+     */
+    void forEachChildOf(const std::string_view &name, PersonVisitor visit) override
     {
-        // Iterate through the children of the person named "John"
-        for (auto &child : browser.findAllChildrenOf(name))
+        for (auto &[first, rel, second] : relations)
         {
-            // Print the name of each child
-            std::cout << name << " has a child called " << child->name << std::endl;
+            if (first.name == name && rel == Relationship::parent)
+            {
+                visit(second);
+            }
         }
     }
 
-    // Destructor - Empty as there are no resources to deallocate
-    ~Research()
+    /**
+     * Overrides the findAllParentsOf() method of the RelationshipBrowser interface.
+     *
+     * @param name The name of the person whose parents should be found.
+     * @return A vector of pointers to the parents of the given person.
+     */
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
     {
-    }
+        std::vector<Person *> result;
 
-    /*
-        // Alternative constructor that directly accesses the relationships data
-         Research(Relationships &relationships)
+        if (mode == StorageMode::singleEdge)
         {
-               // Access the relationships vector from the `relationships` object
-             auto &relations = relationships.relations;
-               // Iterate through the relationships, searching for the parent-child pair with "John" as the parent
-             for (auto &&[first, rel, second] : relations)
-             {
-                   // Check if the first person is "John" and the relationship is "parent"
-                 if (first.name == "John" && rel == Relationship::parent)
-                 {
-                     std::cout << "John has a child called " << second.name << std::endl;
-                 }
-             }
+            if (!reverseIndexBuilt.load(std::memory_order_acquire))
+            {
+                std::lock_guard guard{reverseIndexLock};
+                if (!reverseIndexBuilt.load(std::memory_order_relaxed))
+                {
+                    indexParents();
+                }
+            }
+            if (auto it = reverseIndex.find(name); it != reverseIndex.end())
+            {
+                for (std::size_t i : it->second)
+                {
+                    result.push_back(&std::get<0>(relations[i]));
+                }
+            }
+            return result;
         }
-    */
+
+        for (auto &[first, rel, second] : relations)
+        {
+            if (first.name == name && rel == Relationship::child)
+            {
+                result.push_back(&second);
+            }
+        }
+        return result;
+    }
 };
 
-int main()
+/**
+ * Runs f(begin, end) over [0, n) split into one contiguous chunk per hardware thread.
+ * Small ranges are run on the calling thread.
+ */
+template <typename F> void parallelFor(std::size_t n, F f, std::size_t minChunk = 1 << 12)
 {
-    // Create persons
-    Person parent{"John"};
-    Person child1{"Chris"};
-    Person child2{"Matt"};
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max<std::size_t>(1, n / minChunk));
+    if (threads == 1)
+    {
+        f(std::size_t{0}, n);
+        return;
+    }
 
-    Person parent2{"Greg"};
-    Person child3{"Dominic"};
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back(f, n * t / threads, n * (t + 1) / threads);
+    }
+    for (auto &w : workers)
+    {
+        w.join();
+    }
+}
 
-    // Create a Relationships object to store the relationships
-    Relationships relationships;
-    relationships.addParentAndChild(parent, child1);
-    relationships.addParentAndChild(parent, child2);
-    relationships.addParentAndChild(parent2, child3);
+/**
+ * Stable sort that sorts one chunk per hardware thread and then merges neighbouring chunks in
+ * parallel rounds until one sorted range is left.
+ */
+template <typename T, typename Less> void parallelStableSort(std::vector<T> &items, Less less)
+{
+    const std::size_t n = items.size();
+    std::size_t chunks = std::min<std::size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                               std::max<std::size_t>(1, n / (1 << 14)));
+    std::vector<std::size_t> bounds;
+    for (std::size_t c = 0; c <= chunks; ++c)
+    {
+        bounds.push_back(n * c / chunks);
+    }
 
-    // Create an instance of the Research class using the Relationships object
-    Research exploreRelationships(relationships, "Greg");
+    parallelFor(
+        chunks,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t c = first; c < last; ++c)
+            {
+                std::stable_sort(items.begin() + bounds[c], items.begin() + bounds[c + 1], less);
+            }
+        },
+        1);
+
+    for (std::size_t width = 1; width < chunks; width *= 2)
+    {
+        std::size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+        parallelFor(
+            pairs,
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t pair = first; pair < last; ++pair)
+                {
+                    std::size_t lo = pair * 2 * width;
+                    std::size_t mid = std::min(lo + width, chunks);
+                    std::size_t hi = std::min(lo + 2 * width, chunks);
+                    std::inplace_merge(items.begin() + bounds[lo], items.begin() + bounds[mid],
+                                       items.begin() + bounds[hi], less);
+                }
+            },
+            1);
+    }
+}
+
+/**
+ * A dense id given to every distinct person name.
+ */
+using PersonId = std::uint32_t;
+
+/**
+ * An interning table that owns the storage of every name it has seen and maps each distinct
+ * name to a dense PersonId.
+ *
+ * Names are copied into large arena blocks, so the string_views handed out stay valid for the
+ * lifetime of the table (also after it is moved) regardless of what the caller does with the
+ * original strings. Lookups use an open-addressing hash table of ids with the hash of every name
+ * cached, so most probes are decided without comparing any characters.
+ */
+class NameTable
+{
+    static constexpr std::size_t blockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *current = nullptr; // block that short names are appended to
+    std::size_t currentUsed = 0;
+    std::size_t arenaBytes = 0;
+
+    std::vector<std::string_view> names;   // indexed by id
+    std::vector<std::uint64_t> hashes;     // indexed by id
+    std::vector<std::uint32_t> slots;      // id + 1, or 0 for an empty slot
+
+    std::string_view store(std::string_view name)
+    {
+        char *dest;
+        if (name.size() > blockSize / 4)
+        {
+            // Long names get a block of their own so they do not waste the current one.
+            blocks.push_back(std::make_unique<char[]>(name.size()));
+            dest = blocks.back().get();
+            arenaBytes += name.size();
+        }
+        else
+        {
+            if (current == nullptr || currentUsed + name.size() > blockSize)
+            {
+                blocks.push_back(std::make_unique<char[]>(blockSize));
+                current = blocks.back().get();
+                currentUsed = 0;
+                arenaBytes += blockSize;
+            }
+            dest = current + currentUsed;
+            currentUsed += name.size();
+        }
+        std::memcpy(dest, name.data(), name.size());
+        return {dest, name.size()};
+    }
+
+    void grow()
+    {
+        rehash(slots.empty() ? 1024 : slots.size() * 2);
+    }
+
+    void rehash(std::size_t slotCount)
+    {
+        slots.assign(slotCount, 0);
+        std::size_t mask = slots.size() - 1;
+        for (PersonId id = 0; id < names.size(); ++id)
+        {
+            std::size_t i = hashes[id] & mask;
+            while (slots[i] != 0)
+            {
+                i = (i + 1) & mask;
+            }
+            slots[i] = id + 1;
+        }
+    }
+
+    /**
+     * Returns the slot holding the name, or the empty slot where it would be inserted.
+     */
+    std::size_t probe(std::string_view name, std::uint64_t h) const
+    {
+        std::size_t mask = slots.size() - 1;
+        std::size_t i = h & mask;
+        while (slots[i] != 0)
+        {
+            PersonId id = slots[i] - 1;
+            if (hashes[id] == h && names[id] == name)
+            {
+                break;
+            }
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+  public:
+    /**
+     * FNV-1a over the bytes of the name; the hash used by the table.
+     */
+    static std::uint64_t hash(std::string_view name)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : name)
+        {
+            h = (h ^ c) * 1099511628211ull;
+        }
+        return h;
+    }
+
+    /**
+     * Returns the id of the given name, adding it to the table if it is new.
+     *
+     * @param name The name to intern; it is copied, so it may be a temporary.
+     * @return The dense id of the name.
+     */
+    PersonId intern(std::string_view name)
+    {
+        return intern(name, hash(name));
+    }
+
+    /**
+     * Same as intern(name), for callers that have already computed hash(name).
+     */
+    PersonId intern(std::string_view name, std::uint64_t h)
+    {
+        if ((names.size() + 1) * 2 > slots.size())
+        {
+            grow();
+        }
+        std::size_t i = probe(name, h);
+        if (slots[i] == 0)
+        {
+            names.push_back(store(name));
+            hashes.push_back(h);
+            slots[i] = static_cast<std::uint32_t>(names.size());
+        }
+        return slots[i] - 1;
+    }
+
+    /**
+     * Joins tables holding disjoint sets of names into one. The names of parts[k] keep their
+     * order and are shifted by the sizes of the parts before it; their storage is moved, not
+     * copied, and the cached hashes mean no name is hashed or compared again.
+     */
+    static NameTable concatenate(std::vector<NameTable> parts)
+    {
+        NameTable result;
+        for (auto &part : parts)
+        {
+            for (auto &block : part.blocks)
+            {
+                result.blocks.push_back(std::move(block));
+            }
+            result.arenaBytes += part.arenaBytes;
+            result.names.insert(result.names.end(), part.names.begin(), part.names.end());
+            result.hashes.insert(result.hashes.end(), part.hashes.begin(), part.hashes.end());
+        }
+
+        std::size_t slotCount = 1024;
+        while (slotCount < result.names.size() * 2)
+        {
+            slotCount *= 2;
+        }
+        result.rehash(slotCount);
+        return result;
+    }
+
+    /**
+     * Returns the id of the given name without adding it.
+     */
+    std::optional<PersonId> find(std::string_view name) const
+    {
+        if (slots.empty())
+        {
+            return std::nullopt;
+        }
+        std::size_t i = probe(name, hash(name));
+        if (slots[i] == 0)
+        {
+            return std::nullopt;
+        }
+        return slots[i] - 1;
+    }
+
+    /**
+     * Returns the interned name of the given id, backed by the table's own storage.
+     */
+    std::string_view name(PersonId id) const
+    {
+        return names[id];
+    }
+
+    std::size_t size() const
+    {
+        return names.size();
+    }
+
+    /**
+     * Returns the approximate number of bytes used by the table.
+     */
+    std::size_t memoryBytes() const
+    {
+        return arenaBytes + names.capacity() * sizeof(std::string_view) +
+               hashes.capacity() * sizeof(std::uint64_t) + slots.capacity() * sizeof(std::uint32_t);
+    }
+};
+
+/**
+ * Collects the ids of everyone sharing a parent with `id`, sorted and without duplicates.
+ *
+ * @param parentsOf Returns the parent ids of a person.
+ * @param childrenOf Returns the child ids of a person.
+ */
+template <typename Parents, typename Children>
+std::vector<PersonId> siblingIds(PersonId id, Parents parentsOf, Children childrenOf)
+{
+    std::vector<PersonId> result;
+    for (PersonId parent : parentsOf(id))
+    {
+        for (PersonId child : childrenOf(parent))
+        {
+            if (child != id)
+            {
+                result.push_back(child);
+            }
+        }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+/**
+ * A RelationshipBrowser that keeps, for every parent, a contiguous list of their children's ids.
+ *
+ * Relationships::findAllChildrenOf scans every stored tuple on each call; here a lookup is one
+ * hash probe in the name table followed by a walk over that person's children, so its cost is
+ * O(children) no matter how many relationships are stored. Names are interned on the way in, so
+ * everything past the API boundary works on ids and the stored names cannot dangle.
+ */
+class IndexedRelationships : public RelationshipBrowser
+{
+    NameTable names;
+
+    /**
+     * One Person per id whose name points into `names`. A deque keeps the addresses stable as
+     * people are added, so pointers returned by findAllChildrenOf stay valid.
+     */
+    std::deque<Person> people;
+
+    /**
+     * The ids of the children of each person, indexed by the parent's id.
+     */
+    std::vector<std::vector<PersonId>> children;
+
+    /**
+     * The ids of the parents of each person, indexed by the child's id.
+     */
+    std::vector<std::vector<PersonId>> parents;
+
+    std::uint64_t changes = 0;
+
+    PersonId intern(const Person &person)
+    {
+        PersonId id = names.intern(person.name);
+        if (id == people.size())
+        {
+            people.push_back(Person{names.name(id)});
+            children.emplace_back();
+            parents.emplace_back();
+        }
+        return id;
+    }
+
+    std::vector<Person *> lookup(const std::vector<std::vector<PersonId>> &index, std::string_view name)
+    {
+        std::vector<Person *> result;
+
+        auto id = idOf(name);
+        if (!id)
+        {
+            return result;
+        }
+
+        result.reserve(index[*id].size());
+        for (PersonId relative : index[*id])
+        {
+            result.push_back(&people[relative]);
+        }
+        return result;
+    }
+
+  public:
+    /**
+     * Adds a parent-child relationship between the given parents and child.
+     *
+     * @param parent The parent person.
+     * @param child The child person.
+     */
+    void addParentAndChild(const Person &parent, const Person &child)
+    {
+        PersonId parentId = intern(parent);
+        PersonId childId = intern(child);
+        children[parentId].push_back(childId);
+        parents[childId].push_back(parentId);
+        ++changes;
+    }
+
+    /**
+     * Returns the number of relationships added so far.
+     */
+    std::uint64_t version() override
+    {
+        return changes;
+    }
+
+    /**
+     * Returns the id of the person with the given name, if they are known.
+     */
+    std::optional<PersonId> idOf(std::string_view name) const
+    {
+        return names.find(name);
+    }
+
+    const Person &person(PersonId id) const
+    {
+        return people[id];
+    }
+
+    std::size_t size() const
+    {
+        return people.size();
+    }
+
+    /**
+     * Returns a vector of pointers to all the children of the person with the given name.
+     *
+     * @param name The name of the person whose children should be found.
+     * @return A vector of pointers to the children of the given person.
+     */
+    std::vector<Person *> findAllChildrenOf(const std::string_view &name) override
+    {
+        return lookup(children, name);
+    }
+
+    /**
+     * Calls `visit` with each child of the person with the given name, without allocating.
+     *
+     * @param name The name of the person whose children should be visited.
+     * @param visit Called once per child.
+     */
+    void forEachChildOf(const std::string_view &name, PersonVisitor visit) override
+    {
+        if (auto id = idOf(name))
+        {
+            for (PersonId child : children[*id])
+            {
+                visit(people[child]);
+            }
+        }
+    }
+
+    /**
+     * Returns a view of the ids of a person's children, valid until that person gets another child.
+     */
+    std::span<const PersonId> childrenOf(PersonId id) const
+    {
+        return children[id];
+    }
+
+    /**
+     * Returns a view of the ids of a person's parents, valid until that person gets another parent.
+     */
+    std::span<const PersonId> parentsOf(PersonId id) const
+    {
+        return parents[id];
+    }
+
+    /**
+     * Returns a vector of pointers to all the parents of the person with the given name.
+     *
+     * @param name The name of the person whose parents should be found.
+     * @return A vector of pointers to the parents of the given person.
+     */
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
+    {
+        return lookup(parents, name);
+    }
+
+    /**
+     * Returns the siblings of the person with the given name, derived from the parent index.
+     *
+     * @param name The name of the person whose siblings should be found.
+     * @return A vector of pointers to the siblings of the given person.
+     */
+    std::vector<Person *> findAllSiblingsOf(const std::string_view &name) override
+    {
+        std::vector<Person *> result;
+        if (auto id = idOf(name))
+        {
+            auto siblings = siblingIds(
+                *id, [this](PersonId v) -> auto & { return parents[v]; },
+                [this](PersonId v) -> auto & { return children[v]; });
+            for (PersonId sibling : siblings)
+            {
+                result.push_back(&people[sibling]);
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * A frozen, read-only snapshot of a relationship store in compressed sparse row (CSR) form.
+ *
+ * Every person is given a dense 32-bit id. For each kind of relationship there is one offsets
+ * array and one targets array: the children of person `p` are
+ * `children.targets[children.offsets[p] .. children.offsets[p + 1])`, and the parents are stored
+ * the same way. Each parent-child pair is held once per direction as two 4-byte ids instead of
+ * two full tuples of names, and walking someone's relatives reads consecutive memory.
+ */
+class RelationshipGraph : public RelationshipBrowser
+{
+  public:
+    /**
+     * The adjacency lists of one kind of relationship, in CSR form.
+     */
+    struct Adjacency
+    {
+        std::vector<std::uint32_t> offsets;
+        std::vector<PersonId> targets;
+
+        /**
+         * Returns the ids related to the given person.
+         *
+         * @param id The person whose relatives should be returned.
+         * @return A view of the related ids, valid as long as the graph.
+         */
+        std::span<const PersonId> of(PersonId id) const
+        {
+            return {targets.data() + offsets[id], targets.data() + offsets[id + 1]};
+        }
+    };
+
+    /**
+     * A chain of parent-child links between two people.
+     */
+    struct Path
+    {
+        /**
+         * The people along the chain, from the first person to the last.
+         */
+        std::vector<PersonId> people;
+
+        /**
+         * How each person is related to the one before them: links[i] is the relationship of
+         * people[i + 1] to people[i], either Relationship::parent or Relationship::child.
+         */
+        std::vector<Relationship> links;
+    };
+
+  private:
+    /**
+     * Owns the names and maps them to ids.
+     */
+    NameTable names;
+
+    /**
+     * The people in the graph, indexed by their id, with names pointing into `names`.
+     */
+    std::vector<Person> people;
+
+    Adjacency children;
+    Adjacency parents;
+
+  public:
+    /**
+     * Builds one adjacency kind from (from, to) pairs: the pairs are stably sorted on `from` in
+     * parallel, so each person's relatives keep the order they were given in, and each offset is
+     * then found by a binary search for where that person's run of pairs starts.
+     */
+    static Adjacency compress(std::size_t count, const std::vector<std::pair<PersonId, PersonId>> &edges, bool reverse)
+    {
+        std::vector<std::pair<PersonId, PersonId>> keyed(edges.size());
+        parallelFor(edges.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                keyed[i] = reverse ? std::pair{edges[i].second, edges[i].first} : edges[i];
+            }
+        });
+        parallelStableSort(keyed, [](const auto &a, const auto &b) { return a.first < b.first; });
+
+        Adjacency result;
+        result.offsets.resize(count + 1);
+        result.targets.resize(keyed.size());
+        parallelFor(keyed.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                result.targets[i] = keyed[i].second;
+            }
+        });
+        parallelFor(count + 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                auto it = std::lower_bound(keyed.begin(), keyed.end(), p,
+                                           [](const auto &edge, std::size_t id) { return edge.first < id; });
+                result.offsets[p] = static_cast<std::uint32_t>(it - keyed.begin());
+            }
+        });
+        return result;
+    }
+
+    /**
+     * Builds the graph from interned names and parent-child edges between their ids.
+     *
+     * @param names The people's names, where a name's id is the person's id.
+     * @param edges (parent id, child id) pairs.
+     */
+    RelationshipGraph(NameTable names, const std::vector<std::pair<PersonId, PersonId>> &edges)
+        : names(std::move(names))
+    {
+        people.reserve(this->names.size());
+        for (PersonId id = 0; id < this->names.size(); ++id)
+        {
+            people.push_back(Person{this->names.name(id)});
+        }
+        children = compress(people.size(), edges, false);
+        parents = compress(people.size(), edges, true);
+    }
+
+    /**
+     * Freezes the current contents of a mutable Relationships store.
+     *
+     * @param relationships The store to convert.
+     * @return A graph holding the same parent-child relationships.
+     */
+    static RelationshipGraph build(const Relationships &relationships)
+    {
+        NameTable names;
+
+        // Every pair is stored twice in Relationships; the parent tuples alone describe all edges.
+        std::vector<std::pair<PersonId, PersonId>> edges;
+        for (auto &[first, rel, second] : relationships.relations)
+        {
+            if (rel == Relationship::parent)
+            {
+                PersonId parent = names.intern(first.name);
+                edges.emplace_back(parent, names.intern(second.name));
+            }
+        }
+        return RelationshipGraph(std::move(names), edges);
+    }
+
+    /**
+     * Returns the id of the person with the given name, if they are in the graph.
+     */
+    std::optional<PersonId> idOf(std::string_view name) const
+    {
+        return names.find(name);
+    }
+
+    const Person &person(PersonId id) const
+    {
+        return people[id];
+    }
+
+    std::size_t size() const
+    {
+        return people.size();
+    }
+
+    std::span<const PersonId> childrenOf(PersonId id) const
+    {
+        return children.of(id);
+    }
+
+    std::span<const PersonId> parentsOf(PersonId id) const
+    {
+        return parents.of(id);
+    }
+
+    /**
+     * Returns the approximate number of bytes used by the names, people and both adjacency kinds.
+     */
+    std::size_t memoryBytes() const
+    {
+        return names.memoryBytes() + people.capacity() * sizeof(Person) +
+               (children.offsets.capacity() + children.targets.capacity() + parents.offsets.capacity() +
+                parents.targets.capacity()) *
+                   sizeof(std::uint32_t);
+    }
+
+    /**
+     * Overrides the findAllChildrenOf() method of the RelationshipBrowser interface.
+     *
+     * @param name The name of the person whose children should be found.
+     * @return A vector of pointers to the children of the given person.
+     */
+    std::vector<Person *> findAllChildrenOf(const std::string_view &name) override
+    {
+        std::vector<Person *> result;
+        if (auto id = idOf(name))
+        {
+            for (PersonId child : childrenOf(*id))
+            {
+                result.push_back(&people[child]);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Calls `visit` with each child of the person with the given name, without allocating.
+     *
+     * @param name The name of the person whose children should be visited.
+     * @param visit Called once per child.
+     */
+    void forEachChildOf(const std::string_view &name, PersonVisitor visit) override
+    {
+        if (auto id = idOf(name))
+        {
+            for (PersonId child : childrenOf(*id))
+            {
+                visit(people[child]);
+            }
+        }
+    }
+
+    /**
+     * Overrides the findAllParentsOf() method of the RelationshipBrowser interface.
+     *
+     * @param name The name of the person whose parents should be found.
+     * @return A vector of pointers to the parents of the given person.
+     */
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
+    {
+        std::vector<Person *> result;
+        if (auto id = idOf(name))
+        {
+            for (PersonId parent : parentsOf(*id))
+            {
+                result.push_back(&people[parent]);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Returns the ids of all descendants of a person, nearest generation first and ordered by id
+     * within a generation.
+     */
+    std::vector<PersonId> descendantsOf(PersonId id, std::size_t maxDepth = anyDepth) const
+    {
+        return traverse(id, children, parents, maxDepth);
+    }
+
+    /**
+     * Returns the ids of all ancestors of a person, nearest generation first and ordered by id
+     * within a generation.
+     */
+    std::vector<PersonId> ancestorsOf(PersonId id, std::size_t maxDepth = anyDepth) const
+    {
+        return traverse(id, parents, children, maxDepth);
+    }
+
+    /**
+     * Returns the ids of everyone sharing a parent with the given person, sorted by id.
+     */
+    std::vector<PersonId> siblingsOf(PersonId id) const
+    {
+        return siblingIds(
+            id, [this](PersonId v) { return parentsOf(v); }, [this](PersonId v) { return childrenOf(v); });
+    }
+
+    std::vector<Person *> findAllSiblingsOf(const std::string_view &name) override
+    {
+        auto id = idOf(name);
+        return id ? toPeople(siblingsOf(*id)) : std::vector<Person *>{};
+    }
+
+    std::vector<Person *> findAllDescendantsOf(const std::string_view &name, std::size_t maxDepth = anyDepth) override
+    {
+        auto id = idOf(name);
+        return id ? toPeople(descendantsOf(*id, maxDepth)) : std::vector<Person *>{};
+    }
+
+    std::vector<Person *> findAllAncestorsOf(const std::string_view &name, std::size_t maxDepth = anyDepth) override
+    {
+        auto id = idOf(name);
+        return id ? toPeople(ancestorsOf(*id, maxDepth)) : std::vector<Person *>{};
+    }
+
+    /**
+     * Finds a shortest chain of parent-child links between two people, moving from a person to
+     * either their parents or their children at each step.
+     *
+     * The search grows from both ends at once and always extends the side whose frontier has
+     * fewer edges, so it only explores around the two people instead of a whole generation of
+     * the graph. Each side marks the people it has reached in a bitset, which is also how the
+     * other side notices that the two searches have met.
+     *
+     * @param from The id of the first person.
+     * @param to The id of the last person.
+     * @return One of the shortest paths, or no value if the two people are not related.
+     */
+    std::optional<Path> shortestPath(PersonId from, PersonId to) const
+    {
+        // How a person was reached: from whom, after how many steps, and as whose parent or child.
+        struct Step
+        {
+            PersonId previous;
+            std::uint32_t depth;
+            Relationship relation;
+        };
+        struct Side
+        {
+            std::vector<std::uint64_t> visited;
+            std::unordered_map<PersonId, Step> steps;
+            std::vector<PersonId> frontier;
+            std::size_t frontierEdges = 0;
+        };
+
+        const std::size_t n = people.size();
+        auto start = [&](PersonId id) {
+            Side side{std::vector<std::uint64_t>((n + 63) / 64, 0), {{id, Step{id, 0, Relationship::sibling}}}, {id}, 0};
+            side.visited[id >> 6] |= std::uint64_t{1} << (id & 63);
+            side.frontierEdges = children.of(id).size() + parents.of(id).size();
+            return side;
+        };
+        auto reached = [](const Side &side, PersonId v) { return (side.visited[v >> 6] >> (v & 63)) & 1; };
+        Side forward = start(from);
+        Side backward = start(to);
+        std::optional<PersonId> meeting = from == to ? std::optional{from} : std::nullopt;
+        std::mutex lock;
+
+        while (!meeting && !forward.frontier.empty() && !backward.frontier.empty())
+        {
+            Side &side = forward.frontierEdges <= backward.frontierEdges ? forward : backward;
+            const Side &other = &side == &forward ? backward : forward;
+            std::uint32_t depth = side.steps[side.frontier.front()].depth + 1;
+
+            // Expand the whole level in parallel; the bitset decides which thread claims a person.
+            std::vector<std::tuple<PersonId, PersonId, Relationship>> found;
+            parallelFor(
+                side.frontier.size(),
+                [&](std::size_t begin, std::size_t end) {
+                    std::vector<std::tuple<PersonId, PersonId, Relationship>> local;
+                    auto claim = [&](PersonId v) {
+                        std::uint64_t bit = std::uint64_t{1} << (v & 63);
+                        return (std::atomic_ref(side.visited[v >> 6]).fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+                    };
+                    for (std::size_t i = begin; i < end; ++i)
+                    {
+                        PersonId u = side.frontier[i];
+                        for (PersonId v : children.of(u))
+                        {
+                            if (claim(v))
+                            {
+                                local.emplace_back(v, u, Relationship::child);
+                            }
+                        }
+                        for (PersonId v : parents.of(u))
+                        {
+                            if (claim(v))
+                            {
+                                local.emplace_back(v, u, Relationship::parent);
+                            }
+                        }
+                    }
+                    std::lock_guard guard{lock};
+                    found.insert(found.end(), local.begin(), local.end());
+                },
+                256);
+
+            // Of the people both sides have reached, the one nearest the other end gives the
+            // shortest path; ties go to the lowest id so the answer does not depend on threads.
+            side.frontier.clear();
+            side.frontierEdges = 0;
+            std::uint32_t best = std::numeric_limits<std::uint32_t>::max();
+            PersonId nearest = 0;
+            for (auto &[v, u, relation] : found)
+            {
+                side.steps.emplace(v, Step{u, depth, relation});
+                side.frontier.push_back(v);
+                side.frontierEdges += children.of(v).size() + parents.of(v).size();
+                if (reached(other, v))
+                {
+                    std::uint32_t remaining = other.steps.at(v).depth;
+                    if (remaining < best || (remaining == best && v < nearest))
+                    {
+                        best = remaining;
+                        nearest = v;
+                    }
+                }
+            }
+            if (best != std::numeric_limits<std::uint32_t>::max())
+            {
+                meeting = nearest;
+            }
+        }
+        if (!meeting)
+        {
+            return std::nullopt;
+        }
+
+        // Walk back to `from`, then on to `to`, inverting the links found by the backward side.
+        Path path{{*meeting}, {}};
+        for (PersonId v = *meeting; v != from;)
+        {
+            const Step &step = forward.steps.at(v);
+            path.links.push_back(step.relation);
+            path.people.push_back(v = step.previous);
+        }
+        std::reverse(path.people.begin(), path.people.end());
+        std::reverse(path.links.begin(), path.links.end());
+        for (PersonId v = *meeting; v != to;)
+        {
+            const Step &step = backward.steps.at(v);
+            path.links.push_back(step.relation == Relationship::child ? Relationship::parent : Relationship::child);
+            path.people.push_back(v = step.previous);
+        }
+        return path;
+    }
+
+    /**
+     * Finds a shortest chain of parent-child links between the people with the given names.
+     *
+     * @param from The name of the first person.
+     * @param to The name of the last person.
+     * @return One of the shortest paths, or no value if either person is unknown or they are not related.
+     */
+    std::optional<Path> shortestPath(std::string_view from, std::string_view to) const
+    {
+        auto a = idOf(from), b = idOf(to);
+        return a && b ? shortestPath(*a, *b) : std::nullopt;
+    }
+
+  private:
+    std::vector<Person *> toPeople(const std::vector<PersonId> &ids)
+    {
+        std::vector<Person *> result;
+        result.reserve(ids.size());
+        for (PersonId id : ids)
+        {
+            result.push_back(&people[id]);
+        }
+        return result;
+    }
+
+    /**
+     * Level-synchronous breadth-first search from `start` along `forward` edges.
+     *
+     * People already reached are tracked in a bitset, and each level is expanded in parallel.
+     * While the frontier is small, a level is expanded top-down: every frontier person claims
+     * their unvisited relatives. Once the frontier's edges make up a large part of the edges left
+     * to explore, it switches to bottom-up: every unvisited person checks, through `backward`,
+     * whether one of their relatives is in the frontier, which stops scanning the many edges that
+     * would lead to people already visited. It switches back when the frontier shrinks again.
+     */
+    std::vector<PersonId> traverse(PersonId start, const Adjacency &forward, const Adjacency &backward,
+                                   std::size_t maxDepth) const
+    {
+        const std::size_t n = people.size();
+        std::vector<std::uint64_t> visited((n + 63) / 64, 0);
+        auto isSet = [](std::vector<std::uint64_t> &bits, PersonId v) {
+            return (std::atomic_ref(bits[v >> 6]).load(std::memory_order_relaxed) >> (v & 63)) & 1;
+        };
+        auto claim = [&](PersonId v) {
+            std::uint64_t bit = std::uint64_t{1} << (v & 63);
+            return (std::atomic_ref(visited[v >> 6]).fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+        };
+        claim(start);
+
+        std::vector<PersonId> result;
+        std::vector<PersonId> frontier{start};
+        std::vector<std::uint64_t> inFrontier;
+        std::size_t unexploredEdges = forward.targets.size();
+        bool bottomUp = false;
+        std::mutex lock;
+
+        for (std::size_t depth = 0; depth < maxDepth && !frontier.empty(); ++depth)
+        {
+            std::size_t frontierEdges = 0;
+            for (PersonId u : frontier)
+            {
+                frontierEdges += forward.of(u).size();
+            }
+            if (!bottomUp && frontierEdges > unexploredEdges / 14)
+            {
+                bottomUp = true;
+            }
+            else if (bottomUp && frontier.size() < n / 24)
+            {
+                bottomUp = false;
+            }
+            unexploredEdges -= std::min(frontierEdges, unexploredEdges);
+
+            std::vector<PersonId> next;
+            auto publish = [&](std::vector<PersonId> &found) {
+                std::lock_guard guard{lock};
+                next.insert(next.end(), found.begin(), found.end());
+            };
+
+            if (bottomUp)
+            {
+                inFrontier.assign(visited.size(), 0);
+                for (PersonId u : frontier)
+                {
+                    inFrontier[u >> 6] |= std::uint64_t{1} << (u & 63);
+                }
+                parallelFor(n, [&](std::size_t begin, std::size_t end) {
+                    std::vector<PersonId> found;
+                    for (std::size_t v = begin; v < end; ++v)
+                    {
+                        if (isSet(visited, static_cast<PersonId>(v)))
+                        {
+                            continue;
+                        }
+                        for (PersonId u : backward.of(static_cast<PersonId>(v)))
+                        {
+                            if ((inFrontier[u >> 6] >> (u & 63)) & 1)
+                            {
+                                claim(static_cast<PersonId>(v));
+                                found.push_back(static_cast<PersonId>(v));
+                                break;
+                            }
+                        }
+                    }
+                    publish(found);
+                });
+            }
+            else
+            {
+                parallelFor(
+                    frontier.size(),
+                    [&](std::size_t begin, std::size_t end) {
+                        std::vector<PersonId> found;
+                        for (std::size_t i = begin; i < end; ++i)
+                        {
+                            for (PersonId v : forward.of(frontier[i]))
+                            {
+                                if (claim(v))
+                                {
+                                    found.push_back(v);
+                                }
+                            }
+                        }
+                        publish(found);
+                    },
+                    256);
+            }
+
+            // Threads finish in any order; sorting each level keeps the result deterministic.
+            std::sort(next.begin(), next.end());
+            result.insert(result.end(), next.begin(), next.end());
+            frontier = std::move(next);
+        }
+        return result;
+    }
+};
+
+/**
+ * A relationship store that can be queried from any number of threads while another thread is
+ * adding relationships.
+ *
+ * Readers never take a lock: each query works on an immutable snapshot (a name index plus CSR
+ * adjacency) reached through one atomic pointer. Writers add relationships to a pending batch under
+ * a mutex, and publish() turns everything added so far into a new snapshot and swaps it in.
+ *
+ * Old snapshots are freed with epoch-based reclamation: a reader announces the global epoch in a
+ * slot while it holds a snapshot, publishing advances the epoch, and a replaced snapshot is freed
+ * once no slot shows an epoch from before its replacement. People live in storage that never
+ * moves, so the pointers returned by queries stay valid for the lifetime of the store.
+ *
+ * There are 128 slots. When they are all taken, for example by more than 128 concurrent readers
+ * or by visitors that query the store again from inside forEachChildOf, a reader counts itself
+ * in a shared overflow counter instead of waiting; while that counter is non-zero no snapshot is
+ * freed, and reclamation catches up at a later publish().
+ *
+ * Building a snapshot is linear in the size of the store, so writers should publish in batches.
+ */
+class ConcurrentRelationships : public RelationshipBrowser
+{
+    struct Snapshot
+    {
+        std::uint64_t version = 0;
+        std::unordered_map<std::string_view, PersonId> ids;
+        std::vector<Person *> people;
+        RelationshipGraph::Adjacency children, parents;
+    };
+
+    // Writer state, guarded by `writer`.
+    std::mutex writer;
+    NameTable names;
+    std::deque<Person> people;
+    std::vector<std::pair<PersonId, PersonId>> edges;
+    std::vector<std::pair<std::uint64_t, Snapshot *>> retired; // (epoch it was replaced in, snapshot)
+
+    // Reader state.
+    std::atomic<Snapshot *> current;
+    std::atomic<std::uint64_t> epoch{1};
+
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<std::uint64_t> epoch{0}; // 0 while the slot is free
+    };
+    static constexpr std::size_t slotCount = 128;
+    ReaderSlot slots[slotCount];
+    std::atomic<std::size_t> overflowReaders{0}; // readers that found every slot taken
+
+    /**
+     * Holds a snapshot for the duration of one query.
+     */
+    class ReadGuard
+    {
+        ReaderSlot *slot = nullptr;
+        std::atomic<std::size_t> &overflow;
+
+      public:
+        const Snapshot *snapshot;
+
+        explicit ReadGuard(ConcurrentRelationships &store) : overflow(store.overflowReaders)
+        {
+            std::size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+            for (std::size_t i = 0; i < slotCount && !slot; ++i)
+            {
+                std::uint64_t expected = 0;
+                ReaderSlot &candidate = store.slots[(start + i) % slotCount];
+                if (candidate.epoch.compare_exchange_strong(expected, store.epoch.load()))
+                {
+                    slot = &candidate;
+                }
+            }
+            if (!slot)
+            {
+                overflow.fetch_add(1);
+            }
+            snapshot = store.current.load();
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        ~ReadGuard()
+        {
+            if (slot)
+            {
+                slot->epoch.store(0, std::memory_order_release);
+            }
+            else
+            {
+                overflow.fetch_sub(1, std::memory_order_release);
+            }
+        }
+    };
+
+    PersonId intern(const Person &person)
+    {
+        PersonId id = names.intern(person.name);
+        if (id == people.size())
+        {
+            people.push_back(Person{names.name(id)});
+        }
+        return id;
+    }
+
+    /**
+     * Frees the retired snapshots that no reader can still hold. Called with `writer` held.
+     */
+    void reclaim()
+    {
+        // An overflow reader may hold any snapshot. Its increment comes before its load of
+        // `current`, so once the count reads zero every later reader sees the latest snapshot.
+        if (overflowReaders.load() != 0)
+        {
+            return;
+        }
+        std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+        for (auto &slot : slots)
+        {
+            std::uint64_t e = slot.epoch.load();
+            if (e != 0)
+            {
+                oldest = std::min(oldest, e);
+            }
+        }
+        std::erase_if(retired, [&](auto &entry) {
+            if (entry.first <= oldest)
+            {
+                delete entry.second;
+                return true;
+            }
+            return false;
+        });
+    }
+
+  public:
+    ConcurrentRelationships() : current(new Snapshot)
+    {
+    }
+
+    ConcurrentRelationships(const ConcurrentRelationships &) = delete;
+    ConcurrentRelationships &operator=(const ConcurrentRelationships &) = delete;
+
+    ~ConcurrentRelationships()
+    {
+        for (auto &[_, snapshot] : retired)
+        {
+            delete snapshot;
+        }
+        delete current.load();
+    }
+
+    /**
+     * Adds a parent-child relationship to the pending batch; readers see it after publish().
+     *
+     * @param parent The parent person.
+     * @param child The child person.
+     */
+    void addParentAndChild(const Person &parent, const Person &child)
+    {
+        std::lock_guard guard{writer};
+        PersonId parentId = intern(parent);
+        edges.emplace_back(parentId, intern(child));
+    }
+
+    /**
+     * Makes every relationship added so far visible to readers as a new snapshot.
+     */
+    void publish()
+    {
+        std::lock_guard guard{writer};
+        auto *next = new Snapshot;
+        next->version = current.load()->version + 1;
+        next->ids.reserve(people.size());
+        next->people.reserve(people.size());
+        for (PersonId id = 0; id < people.size(); ++id)
+        {
+            next->ids.emplace(names.name(id), id);
+            next->people.push_back(&people[id]);
+        }
+        next->children = RelationshipGraph::compress(people.size(), edges, false);
+        next->parents = RelationshipGraph::compress(people.size(), edges, true);
+
+        Snapshot *previous = current.exchange(next);
+        // Readers announcing an epoch after this increment can only have loaded `next`.
+        std::uint64_t replacedIn = epoch.fetch_add(1) + 1;
+        retired.emplace_back(replacedIn, previous);
+        reclaim();
+    }
+
+    /**
+     * Returns the version of the snapshot readers currently see; it grows with every publish().
+     */
+    std::uint64_t version() override
+    {
+        ReadGuard read{*this};
+        return read.snapshot->version;
+    }
+
+    std::vector<Person *> findAllChildrenOf(const std::string_view &name) override
+    {
+        return lookup(name, &Snapshot::children);
+    }
+
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
+    {
+        return lookup(name, &Snapshot::parents);
+    }
+
+    void forEachChildOf(const std::string_view &name, PersonVisitor visit) override
+    {
+        ReadGuard read{*this};
+        auto it = read.snapshot->ids.find(name);
+        if (it != read.snapshot->ids.end())
+        {
+            for (PersonId child : read.snapshot->children.of(it->second))
+            {
+                visit(*read.snapshot->people[child]);
+            }
+        }
+    }
+
+  private:
+    std::vector<Person *> lookup(std::string_view name, RelationshipGraph::Adjacency Snapshot::*kind)
+    {
+        std::vector<Person *> result;
+        ReadGuard read{*this};
+        auto it = read.snapshot->ids.find(name);
+        if (it != read.snapshot->ids.end())
+        {
+            for (PersonId relative : (read.snapshot->*kind).of(it->second))
+            {
+                result.push_back(read.snapshot->people[relative]);
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * A RelationshipBrowser that remembers the answers of another browser.
+ *
+ * Results are cached per (query, name) in a set of shards, each an LRU list guarded by its own
+ * mutex, so concurrent callers rarely wait on one another. Every entry records the underlying
+ * browser's version() at the time it was computed and is discarded once that version has moved
+ * on. The total size of the cached results is kept under a memory budget by evicting the least
+ * recently used entries of a shard.
+ */
+class CachingRelationshipBrowser : public RelationshipBrowser
+{
+  public:
+    /**
+     * Counters describing how well the cache is doing.
+     */
+    struct Stats
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+        std::size_t bytes = 0;
+
+        double hitRate() const
+        {
+            std::uint64_t total = hits + misses;
+            return total == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(total);
+        }
+    };
+
+  private:
+    enum class Query : std::uint8_t
+    {
+        children,
+        parents,
+        siblings,
+        descendants,
+        ancestors
+    };
+
+    struct Key
+    {
+        Query query;
+        std::size_t depth;
+        std::string name;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key &key) const
+        {
+            return std::hash<std::string>{}(key.name) ^ (static_cast<std::size_t>(key.query) * 0x9e3779b97f4a7c15ull) ^
+                   (key.depth * 0xc2b2ae3d27d4eb4full);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::uint64_t version;
+        std::vector<Person *> result;
+
+        std::size_t bytes() const
+        {
+            return sizeof(Entry) + key.name.size() + result.size() * sizeof(Person *);
+        }
+    };
+
+    struct Shard
+    {
+        std::mutex lock;
+        std::list<Entry> lru; // most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+        std::size_t bytes = 0;
+        std::uint64_t hits = 0, misses = 0, evictions = 0;
+    };
+
+    RelationshipBrowser &browser;
+    std::size_t shardBudget;
+    std::vector<Shard> shards;
+
+    template <typename Compute> std::vector<Person *> cached(Key key, Compute compute)
+    {
+        Shard &shard = shards[KeyHash{}(key) % shards.size()];
+        std::uint64_t version = browser.version();
+        {
+            std::lock_guard guard{shard.lock};
+            auto it = shard.index.find(key);
+            if (it != shard.index.end())
+            {
+                if (it->second->version == version)
+                {
+                    ++shard.hits;
+                    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                    return it->second->result;
+                }
+                shard.bytes -= it->second->bytes();
+                shard.lru.erase(it->second);
+                shard.index.erase(it);
+            }
+            ++shard.misses;
+        }
+
+        // Ask the underlying browser without holding the shard lock.
+        std::vector<Person *> result = compute();
+
+        std::lock_guard guard{shard.lock};
+        if (shard.index.contains(key))
+        {
+            return result; // another thread filled it meanwhile
+        }
+        shard.lru.push_front(Entry{key, version, result});
+        shard.index.emplace(std::move(key), shard.lru.begin());
+        shard.bytes += shard.lru.front().bytes();
+        while (shard.bytes > shardBudget && shard.lru.size() > 1)
+        {
+            Entry &victim = shard.lru.back();
+            shard.bytes -= victim.bytes();
+            shard.index.erase(victim.key);
+            shard.lru.pop_back();
+            ++shard.evictions;
+        }
+        return result;
+    }
+
+  public:
+    /**
+     * @param browser The browser whose answers should be cached; it must outlive the cache.
+     * @param memoryBudget The approximate number of bytes the cached results may use.
+     * @param shardCount How many independently locked parts the cache is split into.
+     */
+    explicit CachingRelationshipBrowser(RelationshipBrowser &browser, std::size_t memoryBudget = 64 << 20,
+                                        std::size_t shardCount = 16)
+        : browser(browser), shardBudget(std::max<std::size_t>(1, memoryBudget / shardCount)), shards(shardCount)
+    {
+    }
+
+    std::vector<Person *> findAllChildrenOf(const std::string_view &name) override
+    {
+        return cached({Query::children, 0, std::string(name)}, [&] { return browser.findAllChildrenOf(name); });
+    }
+
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
+    {
+        return cached({Query::parents, 0, std::string(name)}, [&] { return browser.findAllParentsOf(name); });
+    }
+
+    std::vector<Person *> findAllSiblingsOf(const std::string_view &name) override
+    {
+        return cached({Query::siblings, 0, std::string(name)}, [&] { return browser.findAllSiblingsOf(name); });
+    }
+
+    std::vector<Person *> findAllDescendantsOf(const std::string_view &name, std::size_t maxDepth = anyDepth) override
+    {
+        return cached({Query::descendants, maxDepth, std::string(name)},
+                      [&] { return browser.findAllDescendantsOf(name, maxDepth); });
+    }
+
+    std::vector<Person *> findAllAncestorsOf(const std::string_view &name, std::size_t maxDepth = anyDepth) override
+    {
+        return cached({Query::ancestors, maxDepth, std::string(name)},
+                      [&] { return browser.findAllAncestorsOf(name, maxDepth); });
+    }
+
+    std::uint64_t version() override
+    {
+        return browser.version();
+    }
+
+    /**
+     * Returns the hit, miss and eviction counts and the bytes currently cached.
+     */
+    Stats stats()
+    {
+        Stats total;
+        for (auto &shard : shards)
+        {
+            std::lock_guard guard{shard.lock};
+            total.hits += shard.hits;
+            total.misses += shard.misses;
+            total.evictions += shard.evictions;
+            total.bytes += shard.bytes;
+        }
+        return total;
+    }
+};
+
+/**
+ * A relationship store split into shards that can be read and written independently.
+ *
+ * Every person belongs to the shard chosen by the hash of their name, and each edge is kept with
+ * its owner: a parent's shard holds the parent's children and a child's shard holds the child's
+ * parents. A query about one person therefore touches one shard under its own reader lock, while
+ * traversals expand every generation by asking all shards involved in parallel and merging their
+ * answers.
+ */
+class PartitionedRelationships : public RelationshipBrowser
+{
+    /**
+     * A person in some shard: the shard index in the upper 32 bits, the id inside it below.
+     */
+    using Ref = std::uint64_t;
+
+    /**
+     * A link to a relative, who may live in another shard. The Person is reached through its
+     * stable address, so reading it needs no lock on the relative's shard, whose deque may be
+     * growing; the Ref says where to continue a traversal.
+     */
+    struct Edge
+    {
+        Person *person;
+        Ref ref;
+    };
+
+    struct Shard
+    {
+        mutable std::shared_mutex lock;
+        NameTable names;
+        std::deque<Person> people; // stable addresses, indexed by the id inside the shard
+        std::vector<std::vector<Edge>> children;
+        std::vector<std::vector<Edge>> parents;
+    };
+
+    std::vector<Shard> shards;
+    std::atomic<std::uint64_t> changes{0};
+
+    std::size_t shardOf(std::string_view name) const
+    {
+        return NameTable::hash(name) % shards.size();
+    }
+
+    static Ref makeRef(std::size_t shard, PersonId id)
+    {
+        return (static_cast<Ref>(shard) << 32) | id;
+    }
+
+    /**
+     * Interns a person in their shard, whose lock the caller holds exclusively.
+     */
+    static PersonId intern(Shard &shard, std::string_view name)
+    {
+        PersonId id = shard.names.intern(name);
+        if (id == shard.people.size())
+        {
+            shard.people.push_back(Person{shard.names.name(id)});
+            shard.children.emplace_back();
+            shard.parents.emplace_back();
+        }
+        return id;
+    }
+
+    std::vector<Person *> lookup(std::string_view name, std::vector<std::vector<Edge>> Shard::*kind)
+    {
+        std::vector<Person *> result;
+        Shard &shard = shards[shardOf(name)];
+        std::shared_lock guard{shard.lock};
+        if (auto id = shard.names.find(name))
+        {
+            for (const Edge &relative : (shard.*kind)[*id])
+            {
+                result.push_back(relative.person);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Breadth-first walk along `kind`; every level is split by shard and the shards are read in
+     * parallel, each under its own reader lock.
+     */
+    std::vector<Person *> traverse(std::string_view name, std::size_t maxDepth,
+                                   std::vector<std::vector<Edge>> Shard::*kind)
+    {
+        std::vector<Person *> result;
+        std::size_t home = shardOf(name);
+        std::optional<PersonId> start;
+        {
+            std::shared_lock guard{shards[home].lock};
+            start = shards[home].names.find(name);
+        }
+        if (!start)
+        {
+            return result;
+        }
+
+        std::unordered_set<Ref> seen{makeRef(home, *start)};
+        std::vector<std::vector<PersonId>> frontier(shards.size());
+        frontier[home].push_back(*start);
+
+        for (std::size_t depth = 0; depth < maxDepth; ++depth)
+        {
+            std::vector<std::vector<Edge>> found(shards.size());
+            parallelFor(
+                shards.size(),
+                [&](std::size_t first, std::size_t last) {
+                    for (std::size_t s = first; s < last; ++s)
+                    {
+                        if (frontier[s].empty())
+                        {
+                            continue;
+                        }
+                        std::shared_lock guard{shards[s].lock};
+                        for (PersonId id : frontier[s])
+                        {
+                            auto &relatives = (shards[s].*kind)[id];
+                            found[s].insert(found[s].end(), relatives.begin(), relatives.end());
+                        }
+                    }
+                },
+                1);
+
+            // Merge in shard order and split the new generation by shard again.
+            bool any = false;
+            for (auto &list : frontier)
+            {
+                list.clear();
+            }
+            for (auto &list : found)
+            {
+                for (const Edge &edge : list)
+                {
+                    if (seen.insert(edge.ref).second)
+                    {
+                        result.push_back(edge.person);
+                        frontier[edge.ref >> 32].push_back(static_cast<PersonId>(edge.ref));
+                        any = true;
+                    }
+                }
+            }
+            if (!any)
+            {
+                break;
+            }
+        }
+        return result;
+    }
+
+  public:
+    /**
+     * @param shardCount The number of shards; defaults to one per hardware thread.
+     */
+    explicit PartitionedRelationships(std::size_t shardCount = std::max(1u, std::thread::hardware_concurrency()))
+        : shards(std::max<std::size_t>(1, shardCount))
+    {
+    }
+
+    /**
+     * Adds a parent-child relationship, locking only the shards of the two people.
+     *
+     * @param parent The parent person.
+     * @param child The child person.
+     */
+    void addParentAndChild(const Person &parent, const Person &child)
+    {
+        std::size_t p = shardOf(parent.name), c = shardOf(child.name);
+
+        // Lock in shard order so concurrent writers cannot deadlock.
+        std::unique_lock first{shards[std::min(p, c)].lock};
+        std::unique_lock<std::shared_mutex> second;
+        if (p != c)
+        {
+            second = std::unique_lock{shards[std::max(p, c)].lock};
+        }
+
+        PersonId parentId = intern(shards[p], parent.name);
+        PersonId childId = intern(shards[c], child.name);
+        shards[p].children[parentId].push_back({&shards[c].people[childId], makeRef(c, childId)});
+        shards[c].parents[childId].push_back({&shards[p].people[parentId], makeRef(p, parentId)});
+
+        // Bumped only once the edge is in place, so a reader seeing the new version finds it.
+        changes.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Returns the number of relationships added so far.
+     */
+    std::uint64_t version() override
+    {
+        return changes.load(std::memory_order_acquire);
+    }
+
+    std::vector<Person *> findAllChildrenOf(const std::string_view &name) override
+    {
+        return lookup(name, &Shard::children);
+    }
+
+    /**
+     * Calls `visit` with each child of the person with the given name, without allocating.
+     *
+     * The person's shard stays read-locked while visiting, so `visit` must not add relationships
+     * to this store or query it again.
+     *
+     * @param name The name of the person whose children should be visited.
+     * @param visit Called once per child.
+     */
+    void forEachChildOf(const std::string_view &name, PersonVisitor visit) override
+    {
+        Shard &shard = shards[shardOf(name)];
+        std::shared_lock guard{shard.lock};
+        if (auto id = shard.names.find(name))
+        {
+            for (const Edge &child : shard.children[*id])
+            {
+                visit(*child.person);
+            }
+        }
+    }
+
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
+    {
+        return lookup(name, &Shard::parents);
+    }
+
+    std::vector<Person *> findAllDescendantsOf(const std::string_view &name, std::size_t maxDepth = anyDepth) override
+    {
+        return traverse(name, maxDepth, &Shard::children);
+    }
+
+    std::vector<Person *> findAllAncestorsOf(const std::string_view &name, std::size_t maxDepth = anyDepth) override
+    {
+        return traverse(name, maxDepth, &Shard::parents);
+    }
+};
+
+/**
+ * Builds a RelationshipGraph from an edge list with one "parent,child" or "parent<TAB>child" pair
+ * per line. Blank lines and lines starting with '#' are skipped, and spaces around names are
+ * trimmed.
+ *
+ * Every stage runs in parallel: the text is cut into chunks at line boundaries and each chunk is
+ * parsed and hashed by its own thread, which sorts the names into one bucket per NameTable shard
+ * by hash; each shard then interns the names of its own buckets, so no locking is needed and no
+ * name is looked at by more than one shard; finally the shards are joined and the CSR arrays are
+ * built by parallel sorting.
+ *
+ * @param text The edge list. Only borrowed: the graph keeps its own copy of every name.
+ * @return The graph of all edges in the text.
+ */
+RelationshipGraph loadEdgeList(std::string_view text)
+{
+    struct Edge
+    {
+        std::uint64_t parentHash, childHash;
+    };
+
+    // A name waiting to be interned, and where its shard-local id goes: slot 2i is the parent of
+    // the chunk's edge i, slot 2i + 1 its child.
+    struct Name
+    {
+        std::string_view name;
+        std::uint64_t hash;
+        std::size_t slot;
+    };
+
+    const std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t shards = workers;
+    std::size_t chunks = std::min<std::size_t>(workers, std::max<std::size_t>(1, text.size() / (1 << 16)));
+
+    // Cut the text into chunks that end on a line break.
+    std::vector<std::size_t> bounds{0};
+    for (std::size_t c = 1; c < chunks; ++c)
+    {
+        std::size_t at = std::max(bounds.back(), text.size() * c / chunks);
+        std::size_t newline = text.find('\n', at);
+        bounds.push_back(newline == std::string_view::npos ? text.size() : newline + 1);
+    }
+    bounds.push_back(text.size());
+
+    auto trim = [](std::string_view field) {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\r'))
+        {
+            field.remove_prefix(1);
+        }
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\r'))
+        {
+            field.remove_suffix(1);
+        }
+        return field;
+    };
+
+    std::vector<std::vector<Edge>> parsed(chunks);
+    std::vector<std::vector<std::vector<Name>>> buckets(chunks, std::vector<std::vector<Name>>(shards));
+    parallelFor(
+        chunks,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t c = first; c < last; ++c)
+            {
+                std::string_view rest = text.substr(bounds[c], bounds[c + 1] - bounds[c]);
+                while (!rest.empty())
+                {
+                    std::size_t end = rest.find('\n');
+                    std::string_view line = trim(rest.substr(0, end));
+                    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+
+                    std::size_t separator = line.find('\t');
+                    if (separator == std::string_view::npos)
+                    {
+                        separator = line.find(',');
+                    }
+                    if (line.empty() || line.front() == '#' || separator == std::string_view::npos)
+                    {
+                        continue;
+                    }
+                    std::string_view parent = trim(line.substr(0, separator));
+                    std::string_view child = trim(line.substr(separator + 1));
+                    Edge edge{NameTable::hash(parent), NameTable::hash(child)};
+                    std::size_t slot = 2 * parsed[c].size();
+                    buckets[c][edge.parentHash % shards].push_back({parent, edge.parentHash, slot});
+                    buckets[c][edge.childHash % shards].push_back({child, edge.childHash, slot + 1});
+                    parsed[c].push_back(edge);
+                }
+            }
+        },
+        1);
+
+    // Shard s interns the names of every chunk's bucket s and records their shard-local ids.
+    std::vector<NameTable> tables(shards);
+    std::vector<std::vector<PersonId>> localIds(chunks);
+    for (std::size_t c = 0; c < chunks; ++c)
+    {
+        localIds[c].resize(2 * parsed[c].size());
+    }
+    parallelFor(
+        shards,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t shard = first; shard < last; ++shard)
+            {
+                for (std::size_t c = 0; c < chunks; ++c)
+                {
+                    for (const Name &name : buckets[c][shard])
+                    {
+                        localIds[c][name.slot] = tables[shard].intern(name.name, name.hash);
+                    }
+                    std::vector<Name>().swap(buckets[c][shard]);
+                }
+            }
+        },
+        1);
+
+    std::vector<PersonId> shardStart(shards, 0);
+    for (std::size_t shard = 1; shard < shards; ++shard)
+    {
+        shardStart[shard] = shardStart[shard - 1] + static_cast<PersonId>(tables[shard - 1].size());
+    }
+
+    std::vector<std::size_t> edgeStart(chunks + 1, 0);
+    for (std::size_t c = 0; c < chunks; ++c)
+    {
+        edgeStart[c + 1] = edgeStart[c] + parsed[c].size();
+    }
+    std::vector<std::pair<PersonId, PersonId>> edges(edgeStart[chunks]);
+    parallelFor(
+        chunks,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t c = first; c < last; ++c)
+            {
+                for (std::size_t i = 0; i < parsed[c].size(); ++i)
+                {
+                    auto &edge = parsed[c][i];
+                    edges[edgeStart[c] + i] = {shardStart[edge.parentHash % shards] + localIds[c][2 * i],
+                                               shardStart[edge.childHash % shards] + localIds[c][2 * i + 1]};
+                }
+            }
+        },
+        1);
+
+    return RelationshipGraph(NameTable::concatenate(std::move(tables)), edges);
+}
+
+/**
+ * Reads an edge list file (see loadEdgeList) into a RelationshipGraph.
+ *
+ * @param path The file to read.
+ * @return The graph of all edges in the file.
+ */
+RelationshipGraph loadEdgeListFile(const std::string &path)
+{
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    // Read straight into one string of the file's size rather than through a stream buffer,
+    // which would hold a second copy of the whole file.
+    in.seekg(0, std::ios::end);
+    std::string contents(static_cast<std::size_t>(in.tellg()), '\0');
+    in.seekg(0, std::ios::beg);
+    in.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+    if (!in)
+    {
+        throw std::runtime_error("cannot read " + path);
+    }
+    return loadEdgeList(contents);
+}
+
+/**
+ * The on-disk layout of a relationship graph: a versioned header followed by seven sections,
+ * each starting on an 8-byte boundary and described by its offset, size and checksum.
+ *
+ * The sections hold the name offsets and name bytes, an open-addressing table from NameTable::hash
+ * of a name to its id, and the children and parents in CSR form, so a mapped file answers queries
+ * directly without building anything.
+ */
+struct GraphFileHeader
+{
+    enum Section
+    {
+        nameOffsets,   // std::uint64_t per person, plus one for the end
+        nameBytes,     // the names, back to back
+        nameSlots,     // std::uint32_t per slot: id + 1, or 0 when empty; a power of two in size
+        childOffsets,  // std::uint32_t per person, plus one
+        childTargets,  // std::uint32_t per edge
+        parentOffsets, // std::uint32_t per person, plus one
+        parentTargets, // std::uint32_t per edge
+        sectionCount
+    };
+
+    struct SectionInfo
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t checksum;
+    };
+
+    char magic[8]; // "RELGRAPH"
+    std::uint32_t version;
+    std::uint32_t sections;
+    std::uint64_t people;
+    std::uint64_t edges;
+    SectionInfo section[sectionCount];
+
+    static constexpr std::uint32_t currentVersion = 1;
+
+    /**
+     * FNV-1a over the section's 8-byte words, then its remaining bytes.
+     */
+    static std::uint64_t checksum(const std::byte *data, std::size_t size)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            h = (h ^ word) * 1099511628211ull;
+        }
+        for (; i < size; ++i)
+        {
+            h = (h ^ static_cast<std::uint8_t>(data[i])) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+/**
+ * Writes a graph in the GraphFileHeader format.
+ *
+ * @param graph The graph to save.
+ * @param path The file to create or replace.
+ */
+void writeRelationshipGraph(const RelationshipGraph &graph, const std::string &path)
+{
+    const std::size_t n = graph.size();
+    std::vector<std::vector<std::byte>> sections(GraphFileHeader::sectionCount);
+    auto append = [&](GraphFileHeader::Section section, const auto &value) {
+        auto *bytes = reinterpret_cast<const std::byte *>(&value);
+        sections[section].insert(sections[section].end(), bytes, bytes + sizeof value);
+    };
+
+    std::uint64_t nameOffset = 0;
+    std::uint32_t childOffset = 0, parentOffset = 0;
+    for (PersonId id = 0; id < n; ++id)
+    {
+        std::string_view name = graph.person(id).name;
+        append(GraphFileHeader::nameOffsets, nameOffset);
+        auto *bytes = reinterpret_cast<const std::byte *>(name.data());
+        sections[GraphFileHeader::nameBytes].insert(sections[GraphFileHeader::nameBytes].end(), bytes,
+                                                    bytes + name.size());
+        nameOffset += name.size();
+
+        append(GraphFileHeader::childOffsets, childOffset);
+        for (PersonId child : graph.childrenOf(id))
+        {
+            append(GraphFileHeader::childTargets, child);
+        }
+        childOffset += static_cast<std::uint32_t>(graph.childrenOf(id).size());
+
+        append(GraphFileHeader::parentOffsets, parentOffset);
+        for (PersonId parent : graph.parentsOf(id))
+        {
+            append(GraphFileHeader::parentTargets, parent);
+        }
+        parentOffset += static_cast<std::uint32_t>(graph.parentsOf(id).size());
+    }
+    append(GraphFileHeader::nameOffsets, nameOffset);
+    append(GraphFileHeader::childOffsets, childOffset);
+    append(GraphFileHeader::parentOffsets, parentOffset);
+
+    std::size_t slotCount = 16;
+    while (slotCount < n * 2)
+    {
+        slotCount *= 2;
+    }
+    std::vector<std::uint32_t> slots(slotCount, 0);
+    for (PersonId id = 0; id < n; ++id)
+    {
+        std::size_t i = NameTable::hash(graph.person(id).name) & (slotCount - 1);
+        while (slots[i] != 0)
+        {
+            i = (i + 1) & (slotCount - 1);
+        }
+        slots[i] = id + 1;
+    }
+    auto *slotBytes = reinterpret_cast<const std::byte *>(slots.data());
+    sections[GraphFileHeader::nameSlots].assign(slotBytes, slotBytes + slots.size() * sizeof(std::uint32_t));
+
+    GraphFileHeader header{};
+    std::memcpy(header.magic, "RELGRAPH", 8);
+    header.version = GraphFileHeader::currentVersion;
+    header.sections = GraphFileHeader::sectionCount;
+    header.people = n;
+    header.edges = childOffset;
+    std::uint64_t offset = (sizeof header + 7) & ~std::uint64_t{7};
+    for (std::size_t k = 0; k < GraphFileHeader::sectionCount; ++k)
+    {
+        header.section[k] = {offset, sections[k].size(),
+                             GraphFileHeader::checksum(sections[k].data(), sections[k].size())};
+        offset = (offset + sections[k].size() + 7) & ~std::uint64_t{7};
+    }
+
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    if (!out)
+    {
+        throw std::runtime_error("cannot open " + path);
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof header);
+    for (std::size_t k = 0; k < GraphFileHeader::sectionCount; ++k)
+    {
+        out.seekp(static_cast<std::streamoff>(header.section[k].offset));
+        out.write(reinterpret_cast<const char *>(sections[k].data()), static_cast<std::streamsize>(sections[k].size()));
+    }
+    if (!out)
+    {
+        throw std::runtime_error("failed writing " + path);
+    }
+}
+
+/**
+ * A RelationshipBrowser answering queries straight from a memory-mapped graph file written by
+ * writeRelationshipGraph().
+ *
+ * Opening maps the file and checks its structure: the header and section bounds, then every
+ * offset, target and name slot the queries follow, in parallel. Startup time is therefore linear
+ * in the number of people and edges, although the name bytes are not read. verify() reads
+ * everything to check the section checksums. The id-based queries read the mapped sections
+ * directly. The Person objects behind the pointer-based
+ * queries are created for the whole graph on the first such query.
+ */
+class MappedRelationshipGraph : public RelationshipBrowser
+{
+    const std::byte *base = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+    GraphFileHeader header{};
+
+    std::once_flag peopleCreated;
+    std::vector<Person> people;
+
+    template <typename T> const T *section(GraphFileHeader::Section s) const
+    {
+        return reinterpret_cast<const T *>(base + header.section[s].offset);
+    }
+
+    std::span<const PersonId> related(GraphFileHeader::Section offsets, GraphFileHeader::Section targets,
+                                      PersonId id) const
+    {
+        auto *o = section<std::uint32_t>(offsets);
+        return {section<PersonId>(targets) + o[id], section<PersonId>(targets) + o[id + 1]};
+    }
+
+    Person &person(PersonId id)
+    {
+        std::call_once(peopleCreated, [this] {
+            people.resize(header.people);
+            parallelFor(people.size(), [this](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    people[i].name = name(static_cast<PersonId>(i));
+                }
+            });
+        });
+        return people[id];
+    }
+
+    std::vector<Person *> lookup(GraphFileHeader::Section offsets, GraphFileHeader::Section targets,
+                                 std::string_view name)
+    {
+        std::vector<Person *> result;
+        if (auto id = idOf(name))
+        {
+            for (PersonId relative : related(offsets, targets, *id))
+            {
+                result.push_back(&person(relative));
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Checks that every offset, id and target the queries follow stays inside the mapping, so a
+     * damaged or hostile file is rejected on opening instead of being read out of bounds later.
+     * Runs in parallel over people, edges and name slots.
+     */
+    bool wellFormed() const
+    {
+        using S = GraphFileHeader;
+        const std::uint64_t n = header.people, e = header.edges;
+        std::atomic<bool> ok{true};
+        auto check = [&ok](bool condition) {
+            if (!condition)
+            {
+                ok.store(false, std::memory_order_relaxed);
+            }
+        };
+
+        auto *names = section<std::uint64_t>(S::nameOffsets);
+        check(names[0] == 0 && names[n] <= header.section[S::nameBytes].size);
+        for (auto kind : {S::childOffsets, S::parentOffsets})
+        {
+            auto *o = section<std::uint32_t>(kind);
+            check(o[0] == 0 && o[n] == e);
+            parallelFor(n, [&](std::size_t begin, std::size_t end) {
+                bool sorted = true;
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    sorted &= o[i] <= o[i + 1];
+                }
+                check(sorted);
+            });
+        }
+        parallelFor(n, [&](std::size_t begin, std::size_t end) {
+            bool sorted = true;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                sorted &= names[i] <= names[i + 1];
+            }
+            check(sorted);
+        });
+        for (auto kind : {S::childTargets, S::parentTargets})
+        {
+            auto *targets = section<PersonId>(kind);
+            parallelFor(e, [&](std::size_t begin, std::size_t end) {
+                bool inRange = true;
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    inRange &= targets[i] < n;
+                }
+                check(inRange);
+            });
+        }
+
+        // Slots hold ids + 1; at least one must be empty or a failed lookup would never end.
+        auto *slots = section<std::uint32_t>(S::nameSlots);
+        const std::size_t slotCount = header.section[S::nameSlots].size / sizeof(std::uint32_t);
+        std::atomic<std::size_t> used{0};
+        parallelFor(slotCount, [&](std::size_t begin, std::size_t end) {
+            bool inRange = true;
+            std::size_t count = 0;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                inRange &= slots[i] <= n;
+                count += slots[i] != 0;
+            }
+            check(inRange);
+            used.fetch_add(count, std::memory_order_relaxed);
+        });
+        return ok.load() && used.load() < slotCount;
+    }
+
+    void release()
+    {
+        if (!base)
+        {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        ::munmap(const_cast<std::byte *>(base), length);
+#endif
+        base = nullptr;
+    }
+
+  public:
+    /**
+     * Maps the given graph file and checks its structure, reading the offset, target and slot
+     * sections once; the names themselves are only read by queries. verify() additionally
+     * compares the checksums.
+     *
+     * @param path A file written by writeRelationshipGraph().
+     */
+    explicit MappedRelationshipGraph(const std::string &path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        length = static_cast<std::size_t>(size.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            base = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!base)
+        {
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            throw std::runtime_error("cannot map " + path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            length = static_cast<std::size_t>(st.st_size);
+            void *p = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            base = p == MAP_FAILED ? nullptr : static_cast<const std::byte *>(p);
+        }
+        ::close(fd);
+        if (!base)
+        {
+            throw std::runtime_error("cannot map " + path);
+        }
+#endif
+        bool valid = length >= sizeof header;
+        if (valid)
+        {
+            std::memcpy(&header, base, sizeof header);
+            valid = std::memcmp(header.magic, "RELGRAPH", 8) == 0 && header.version == GraphFileHeader::currentVersion &&
+                    header.sections == GraphFileHeader::sectionCount;
+        }
+        for (std::size_t k = 0; valid && k < GraphFileHeader::sectionCount; ++k)
+        {
+            valid = header.section[k].offset % 8 == 0 && header.section[k].offset <= length &&
+                    header.section[k].size <= length - header.section[k].offset;
+        }
+        std::uint64_t slots = valid ? header.section[GraphFileHeader::nameSlots].size / sizeof(std::uint32_t) : 0;
+        // The counts are bounded first so the size products below cannot wrap around.
+        valid = valid && header.people < std::numeric_limits<PersonId>::max() && header.people < length &&
+                header.edges <= std::numeric_limits<std::uint32_t>::max() && header.edges <= length &&
+                slots != 0 && (slots & (slots - 1)) == 0 &&
+                header.section[GraphFileHeader::nameOffsets].size == (header.people + 1) * sizeof(std::uint64_t) &&
+                header.section[GraphFileHeader::childOffsets].size == (header.people + 1) * sizeof(std::uint32_t) &&
+                header.section[GraphFileHeader::parentOffsets].size == (header.people + 1) * sizeof(std::uint32_t) &&
+                header.section[GraphFileHeader::childTargets].size == header.edges * sizeof(PersonId) &&
+                header.section[GraphFileHeader::parentTargets].size == header.edges * sizeof(PersonId) &&
+                wellFormed();
+        if (!valid)
+        {
+            release();
+            throw std::runtime_error(path + " is not a relationship graph file");
+        }
+    }
+
+    MappedRelationshipGraph(const MappedRelationshipGraph &) = delete;
+    MappedRelationshipGraph &operator=(const MappedRelationshipGraph &) = delete;
+
+    ~MappedRelationshipGraph()
+    {
+        release();
+    }
+
+    /**
+     * Reads every section and compares it with the checksum stored in the header.
+     *
+     * @return Whether all sections are intact.
+     */
+    bool verify() const
+    {
+        for (std::size_t k = 0; k < GraphFileHeader::sectionCount; ++k)
+        {
+            auto &info = header.section[k];
+            if (GraphFileHeader::checksum(base + info.offset, info.size) != info.checksum)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t size() const
+    {
+        return header.people;
+    }
+
+    std::string_view name(PersonId id) const
+    {
+        auto *offsets = section<std::uint64_t>(GraphFileHeader::nameOffsets);
+        return {reinterpret_cast<const char *>(section<std::byte>(GraphFileHeader::nameBytes)) + offsets[id],
+                offsets[id + 1] - offsets[id]};
+    }
+
+    std::optional<PersonId> idOf(std::string_view name) const
+    {
+        auto *slots = section<std::uint32_t>(GraphFileHeader::nameSlots);
+        std::size_t mask = header.section[GraphFileHeader::nameSlots].size / sizeof(std::uint32_t) - 1;
+        for (std::size_t i = NameTable::hash(name) & mask; slots[i] != 0; i = (i + 1) & mask)
+        {
+            if (this->name(slots[i] - 1) == name)
+            {
+                return slots[i] - 1;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::span<const PersonId> childrenOf(PersonId id) const
+    {
+        return related(GraphFileHeader::childOffsets, GraphFileHeader::childTargets, id);
+    }
+
+    std::span<const PersonId> parentsOf(PersonId id) const
+    {
+        return related(GraphFileHeader::parentOffsets, GraphFileHeader::parentTargets, id);
+    }
+
+    std::vector<Person *> findAllChildrenOf(const std::string_view &name) override
+    {
+        return lookup(GraphFileHeader::childOffsets, GraphFileHeader::childTargets, name);
+    }
+
+    std::vector<Person *> findAllParentsOf(const std::string_view &name) override
+    {
+        return lookup(GraphFileHeader::parentOffsets, GraphFileHeader::parentTargets, name);
+    }
+
+    void forEachChildOf(const std::string_view &name, PersonVisitor visit) override
+    {
+        if (auto id = idOf(name))
+        {
+            for (PersonId child : childrenOf(*id))
+            {
+                visit(person(child));
+            }
+        }
+    }
+};
+
+/**
+ * Answers "how are A and B related" queries: the closest common ancestor of two people and how
+ * many generations each of them is below it.
+ *
+ * Every person's first parent defines a primary line, and the primary lines form a forest that is
+ * indexed with binary lifting (the 2^k-th primary ancestor of every person). When neither person
+ * has anyone with more than one parent among their ancestors, their ancestors form a single chain
+ * and the query is answered from the forest in O(log n).
+ *
+ * That is not O(log n) for most real families, where nearly everyone has two parents: the closest
+ * common ancestor may then be reached through any parent, and it is found by searching up from
+ * both people at once, one generation at a time, until no undiscovered ancestor could be closer.
+ * The cost grows with the number of ancestors within that many generations, so close relatives
+ * are cheap and distant ones expensive. People with no founder in common (a founder being someone
+ * without parents) are rejected up front by comparing bitmasks of their founders.
+ *
+ * People can be added one at a time after their parents in O(log n), so the index grows with the
+ * family; adding a parent to someone already indexed needs rebuild().
+ */
+class KinshipIndex
+{
+  public:
+    /**
+     * The result of a kinship query.
+     */
+    struct Kinship
+    {
+        PersonId ancestor;               // the closest common ancestor (possibly one of the two people)
+        std::uint32_t generationsFromA; // 0 if A is the ancestor, 1 if it is A's parent, ...
+        std::uint32_t generationsFromB;
+    };
+
+  private:
+    static constexpr std::uint32_t unknown = std::numeric_limits<std::uint32_t>::max();
+
+    std::vector<std::vector<PersonId>> parents; // all indexed parents, by id
+    std::vector<std::uint32_t> depth;           // generations below the root of the primary line
+    std::vector<std::uint8_t> mixed;            // 1 if the person or an ancestor has several parents
+    std::vector<std::uint64_t> founders;        // one bit per founder above the person, hashed into 64
+    std::vector<std::vector<PersonId>> up;      // up[k][v]: 2^k-th primary ancestor; roots map to themselves
+
+    bool known(PersonId id) const
+    {
+        return id < depth.size() && depth[id] != unknown;
+    }
+
+    std::optional<Kinship> relateOnPrimaryLines(PersonId a, PersonId b) const
+    {
+        std::uint32_t depthA = depth[a], depthB = depth[b];
+        if (depth[a] < depth[b])
+        {
+            std::swap(a, b);
+        }
+        for (std::size_t k = 0; k < up.size(); ++k)
+        {
+            if (((depth[a] - depth[b]) >> k) & 1)
+            {
+                a = up[k][a];
+            }
+        }
+        if (a != b)
+        {
+            for (std::size_t k = up.size(); k-- > 0;)
+            {
+                if (up[k][a] != up[k][b])
+                {
+                    a = up[k][a];
+                    b = up[k][b];
+                }
+            }
+            if (up.empty() || up[0][a] == a || up[0][a] != up[0][b])
+            {
+                return std::nullopt; // different trees of the forest
+            }
+            a = up[0][a];
+        }
+        return Kinship{a, depthA - depth[a], depthB - depth[a]};
+    }
+
+    /**
+     * Searches up from both people, always extending the side with the smaller frontier by one
+     * generation. A person reached by one side who was already reached by the other is a common
+     * ancestor; the search stops once every ancestor neither side has reached yet would be
+     * further away than the best one found.
+     */
+    std::optional<Kinship> relateOverAllParents(PersonId a, PersonId b) const
+    {
+        // Generations from each side, by id. Flat arrays are much cheaper to fill than hash maps;
+        // they are kept per thread and only the entries a query sets are reset, so a query costs
+        // what it reaches rather than the size of the index.
+        thread_local std::vector<std::uint32_t> scratch[2];
+        struct Side
+        {
+            std::vector<std::uint32_t> &distance;
+            std::vector<PersonId> reached;
+            std::vector<PersonId> frontier;
+            std::uint32_t depth = 0; // generations fully explored
+        };
+        for (auto &distance : scratch)
+        {
+            if (distance.size() < depth.size())
+            {
+                distance.resize(depth.size(), unknown);
+            }
+        }
+        Side fromA{scratch[0], {a}, {a}}, fromB{scratch[1], {b}, {b}};
+        fromA.distance[a] = 0;
+        fromB.distance[b] = 0;
+
+        std::optional<Kinship> best;
+        auto total = [](const Kinship &k) { return k.generationsFromA + k.generationsFromB; };
+        auto consider = [&](PersonId v, std::uint32_t generationsFromA, std::uint32_t generationsFromB) {
+            Kinship candidate{v, generationsFromA, generationsFromB};
+            if (!best || total(candidate) < total(*best) || (total(candidate) == total(*best) && v < best->ancestor))
+            {
+                best = candidate;
+            }
+        };
+        if (a == b)
+        {
+            consider(a, 0, 0);
+        }
+
+        for (;;)
+        {
+            // An ancestor not reached by A yet is at least depth + 1 generations above A, and
+            // likewise for B; once A's ancestry is exhausted, nobody left is above A at all.
+            constexpr std::uint32_t never = unknown;
+            std::uint32_t bound = std::min(fromA.frontier.empty() ? never : fromA.depth + 1,
+                                           fromB.frontier.empty() ? never : fromB.depth + 1);
+            if (bound == never || (best && total(*best) < bound))
+            {
+                break;
+            }
+
+            bool extendA = !fromA.frontier.empty() &&
+                           (fromB.frontier.empty() || fromA.frontier.size() <= fromB.frontier.size());
+            Side &side = extendA ? fromA : fromB;
+            const Side &other = extendA ? fromB : fromA;
+            ++side.depth;
+
+            std::vector<PersonId> next;
+            for (PersonId v : side.frontier)
+            {
+                for (PersonId p : parents[v])
+                {
+                    if (side.distance[p] != unknown)
+                    {
+                        continue;
+                    }
+                    side.distance[p] = side.depth;
+                    side.reached.push_back(p);
+                    next.push_back(p);
+                    if (std::uint32_t d = other.distance[p]; d != unknown)
+                    {
+                        extendA ? consider(p, side.depth, d) : consider(p, d, side.depth);
+                    }
+                }
+            }
+            side.frontier = std::move(next);
+        }
+
+        for (Side *side : {&fromA, &fromB})
+        {
+            for (PersonId v : side->reached)
+            {
+                side->distance[v] = unknown;
+            }
+        }
+        return best;
+    }
+
+  public:
+    KinshipIndex() = default;
+
+    /**
+     * Indexes every person of a graph; see rebuild().
+     */
+    explicit KinshipIndex(const RelationshipGraph &graph)
+    {
+        rebuild(graph);
+    }
+
+    /**
+     * Replaces the index with one of the given graph, reusing the memory already allocated. This
+     * is how parents added to people already indexed are taken into account.
+     *
+     * People are indexed parents before their children. People caught in a cycle of parent links
+     * (bad data) are added last, with the links into the cycle ignored.
+     *
+     * @param graph The graph whose people and parent links should be indexed.
+     */
+    void rebuild(const RelationshipGraph &graph)
+    {
+        const std::size_t n = graph.size();
+        depth.assign(n, unknown);
+        mixed.assign(n, 0);
+        founders.assign(n, 0);
+        parents.resize(n);
+        for (auto &level : up)
+        {
+            level.resize(n);
+        }
+
+        std::vector<std::uint32_t> waiting(n);
+        std::vector<PersonId> ready;
+        for (PersonId v = 0; v < n; ++v)
+        {
+            waiting[v] = static_cast<std::uint32_t>(graph.parentsOf(v).size());
+            if (waiting[v] == 0)
+            {
+                ready.push_back(v);
+            }
+        }
+        while (!ready.empty())
+        {
+            PersonId v = ready.back();
+            ready.pop_back();
+            addPerson(v, graph.parentsOf(v));
+            for (PersonId child : graph.childrenOf(v))
+            {
+                if (--waiting[child] == 0)
+                {
+                    ready.push_back(child);
+                }
+            }
+        }
+        for (PersonId v = 0; v < n; ++v)
+        {
+            if (!known(v))
+            {
+                addPerson(v, graph.parentsOf(v));
+                mixed[v] = 1;
+            }
+        }
+    }
+
+    /**
+     * Adds a person whose parents are already indexed, in O(log n).
+     *
+     * @param id The person to add.
+     * @param personParents Their parents; the first one that is indexed defines the primary line,
+     *        parents not indexed yet are ignored.
+     */
+    void addPerson(PersonId id, std::span<const PersonId> personParents)
+    {
+        if (id >= depth.size())
+        {
+            depth.resize(id + 1, unknown);
+            mixed.resize(id + 1, 0);
+            founders.resize(id + 1, 0);
+            parents.resize(id + 1);
+            for (auto &level : up)
+            {
+                level.resize(id + 1);
+            }
+        }
+
+        parents[id].clear();
+        for (PersonId p : personParents)
+        {
+            if (known(p))
+            {
+                parents[id].push_back(p);
+            }
+        }
+        PersonId primary = parents[id].empty() ? id : parents[id].front();
+        // A founder's bit is picked by a multiplicative hash of their id.
+        founders[id] = parents[id].empty() ? std::uint64_t{1} << ((id * 0x9E3779B97F4A7C15ull) >> 58) : 0;
+        for (PersonId p : parents[id])
+        {
+            founders[id] |= founders[p];
+        }
+        depth[id] = primary == id ? 0 : depth[primary] + 1;
+        mixed[id] = parents[id].size() > 1 || (primary != id && mixed[primary]);
+
+        // Make sure there are enough levels to jump over the deepest line.
+        while ((std::uint64_t{1} << up.size()) <= depth[id])
+        {
+            std::vector<PersonId> level(depth.size());
+            for (PersonId v = 0; v < depth.size(); ++v)
+            {
+                level[v] = up.empty() ? v : up.back()[up.back()[v]];
+            }
+            up.push_back(std::move(level));
+        }
+
+        for (std::size_t k = 0; k < up.size(); ++k)
+        {
+            up[k][id] = k == 0 ? primary : up[k - 1][up[k - 1][id]];
+        }
+    }
+
+    /**
+     * Finds the closest common ancestor of two people.
+     *
+     * @return The ancestor and the generations between it and each person, or nothing if the two
+     *         are not related by descent or one of them is not indexed.
+     */
+    std::optional<Kinship> relate(PersonId a, PersonId b) const
+    {
+        if (!known(a) || !known(b) || (founders[a] & founders[b]) == 0)
+        {
+            return std::nullopt;
+        }
+        if (!mixed[a] && !mixed[b])
+        {
+            return relateOnPrimaryLines(a, b);
+        }
+        return relateOverAllParents(a, b);
+    }
+};
+
+/**
+ * Keeps every person's generation: 0 for people without known parents, otherwise one more than
+ * their deepest parent.
+ *
+ * The whole graph is numbered by a level-synchronous topological sort: each level holds the
+ * people whose parents have all been numbered, and is expanded in parallel. After that, new
+ * parent-child links are applied one at a time and only push the generations of the descendants
+ * that actually move down.
+ *
+ * Parent links that form a cycle are bad data: the people on a cycle, and everyone below them,
+ * have no generation and can be listed with findCycle().
+ */
+class GenerationIndex
+{
+    static constexpr std::uint32_t unresolved = std::numeric_limits<std::uint32_t>::max();
+
+    std::vector<std::vector<PersonId>> children;
+    std::vector<std::vector<PersonId>> parents;
+    std::vector<std::uint32_t> generation; // unresolved for people on or below a cycle
+    std::size_t unresolvedCount = 0;
+
+    void grow(PersonId id)
+    {
+        if (id >= generation.size())
+        {
+            children.resize(id + 1);
+            parents.resize(id + 1);
+            generation.resize(id + 1, 0);
+        }
+    }
+
+    /**
+     * Marks `start` and every descendant not already marked as having no generation.
+     */
+    void markUnresolved(PersonId start)
+    {
+        if (generation[start] == unresolved)
+        {
+            return;
+        }
+        generation[start] = unresolved;
+        ++unresolvedCount;
+        std::vector<PersonId> pending{start};
+        while (!pending.empty())
+        {
+            PersonId v = pending.back();
+            pending.pop_back();
+            for (PersonId c : children[v])
+            {
+                if (generation[c] != unresolved)
+                {
+                    generation[c] = unresolved;
+                    ++unresolvedCount;
+                    pending.push_back(c);
+                }
+            }
+        }
+    }
+
+    /**
+     * Returns whether `v` is `ancestor` or one of their descendants.
+     */
+    bool isDescendant(PersonId v, PersonId ancestor) const
+    {
+        std::unordered_set<PersonId> seen{ancestor};
+        std::vector<PersonId> pending{ancestor};
+        while (!pending.empty())
+        {
+            PersonId u = pending.back();
+            pending.pop_back();
+            if (u == v)
+            {
+                return true;
+            }
+            for (PersonId c : children[u])
+            {
+                if (seen.insert(c).second)
+                {
+                    pending.push_back(c);
+                }
+            }
+        }
+        return false;
+    }
+
+  public:
+    GenerationIndex() = default;
+
+    /**
+     * Numbers every person of a graph.
+     *
+     * @param graph The graph whose people and parent-child links should be indexed.
+     */
+    explicit GenerationIndex(const RelationshipGraph &graph)
+    {
+        const std::size_t n = graph.size();
+        children.resize(n);
+        parents.resize(n);
+        generation.assign(n, unresolved);
+        unresolvedCount = n;
+
+        std::vector<std::uint32_t> waiting(n);
+        std::vector<PersonId> level;
+        for (PersonId v = 0; v < n; ++v)
+        {
+            auto c = graph.childrenOf(v), p = graph.parentsOf(v);
+            children[v].assign(c.begin(), c.end());
+            parents[v].assign(p.begin(), p.end());
+            waiting[v] = static_cast<std::uint32_t>(p.size());
+            if (waiting[v] == 0)
+            {
+                level.push_back(v);
+            }
+        }
+
+        std::mutex lock;
+        for (std::uint32_t depth = 0; !level.empty(); ++depth)
+        {
+            unresolvedCount -= level.size();
+            std::vector<PersonId> next;
+            parallelFor(
+                level.size(),
+                [&](std::size_t begin, std::size_t end) {
+                    std::vector<PersonId> found;
+                    for (std::size_t i = begin; i < end; ++i)
+                    {
+                        generation[level[i]] = depth;
+                        for (PersonId c : children[level[i]])
+                        {
+                            // The last parent to be numbered makes the child ready for the next level.
+                            if (std::atomic_ref(waiting[c]).fetch_sub(1, std::memory_order_relaxed) == 1)
+                            {
+                                found.push_back(c);
+                            }
+                        }
+                    }
+                    std::lock_guard guard{lock};
+                    next.insert(next.end(), found.begin(), found.end());
+                },
+                256);
+            level = std::move(next);
+        }
+    }
+
+    /**
+     * Records a parent-child link and updates the generations of the child and their descendants.
+     *
+     * People not seen before are added with generation 0. Descendants are visited in order of
+     * their new generation, so each one that moves is updated once, and those that stay put end
+     * the walk along their line.
+     *
+     * @param parent The id of the parent.
+     * @param child The id of the child.
+     * @return false if the link closes a cycle of parent links, in which case the child and their
+     *         descendants lose their generation.
+     */
+    bool addParentAndChild(PersonId parent, PersonId child)
+    {
+        grow(std::max(parent, child));
+        children[parent].push_back(child);
+        parents[child].push_back(parent);
+
+        if (generation[parent] == unresolved)
+        {
+            // Below a cycle already; the new link is a cycle of its own if it leads back up.
+            bool closesCycle = isDescendant(parent, child);
+            markUnresolved(child);
+            return !closesCycle;
+        }
+        if (generation[child] == unresolved)
+        {
+            return true; // a parent with a generation cannot be below the child
+        }
+        if (generation[parent] + 1 <= generation[child])
+        {
+            return true;
+        }
+
+        // Only a line leading back to the parent keeps being pushed down, so reaching the parent
+        // is the sign of a cycle.
+        using Entry = std::pair<std::uint32_t, PersonId>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<>> pending;
+        generation[child] = generation[parent] + 1;
+        pending.emplace(generation[child], child);
+        while (!pending.empty())
+        {
+            auto [depth, v] = pending.top();
+            pending.pop();
+            if (depth != generation[v])
+            {
+                continue; // moved again since it was queued
+            }
+            for (PersonId c : children[v])
+            {
+                if (c == parent || v == parent)
+                {
+                    markUnresolved(child);
+                    return false;
+                }
+                if (generation[c] < depth + 1)
+                {
+                    generation[c] = depth + 1;
+                    pending.emplace(depth + 1, c);
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Returns the generation of a person, or nothing if they are on or below a cycle. People not
+     * indexed yet have no known parents, so they are generation 0.
+     */
+    std::optional<std::uint32_t> generationOf(PersonId id) const
+    {
+        if (id >= generation.size())
+        {
+            return 0;
+        }
+        if (generation[id] == unresolved)
+        {
+            return std::nullopt;
+        }
+        return generation[id];
+    }
+
+    /**
+     * Returns the number of people without a generation because of a cycle.
+     */
+    std::size_t unresolvedSize() const
+    {
+        return unresolvedCount;
+    }
+
+    /**
+     * Finds one cycle of parent links.
+     *
+     * Everyone without a generation has a parent without one too, so following such parents
+     * must come back to someone already seen.
+     *
+     * @return The people on the cycle, each one a parent of the one before, or an empty vector if
+     *         there is no cycle.
+     */
+    std::vector<PersonId> findCycle() const
+    {
+        auto start = std::find(generation.begin(), generation.end(), unresolved);
+        if (start == generation.end())
+        {
+            return {};
+        }
+
+        std::unordered_map<PersonId, std::size_t> position;
+        std::vector<PersonId> line;
+        PersonId v = static_cast<PersonId>(start - generation.begin());
+        while (position.try_emplace(v, line.size()).second)
+        {
+            line.push_back(v);
+            v = *std::find_if(parents[v].begin(), parents[v].end(),
+                              [this](PersonId p) { return generation[p] == unresolved; });
+        }
+        return {line.begin() + static_cast<std::ptrdiff_t>(position[v]), line.end()};
+    }
+};
+
+// High-level module
+class Research
+{
+  public:
+    // Constructor - Accepts a `RelationshipBrowser` object to access the relationships
+    Research(RelationshipBrowser &browser, std::string_view name)
+    {
+        // Iterate through the children of the person named "John"
+        for (auto &child : browser.findAllChildrenOf(name))
+        {
+            // Print the name of each child
+            std::cout << name << " has a child called " << child->name << std::endl;
+        }
+    }
+
+    // Destructor - Empty as there are no resources to deallocate
+    ~Research()
+    {
+    }
+
+    /*
+        // Alternative constructor that directly accesses the relationships data
+         Research(Relationships &relationships)
+        {
+               // Access the relationships vector from the `relationships` object
+             auto &relations = relationships.relations;
+               // Iterate through the relationships, searching for the parent-child pair with "John" as the parent
+             for (auto &&[first, rel, second] : relations)
+             {
+                   // Check if the first person is "John" and the relationship is "parent"
+                 if (first.name == "John" && rel == Relationship::parent)
+                 {
+                     std::cout << "John has a child called " << second.name << std::endl;
+                 }
+             }
+        }
+    */
+};
+
+// High-level module for many questions at once
+class BatchResearch
+{
+  public:
+    // Constructor - Looks up the children of every name in parallel and writes one line per child,
+    // in the order of `names`, through per-block string buffers that are written out once at the
+    // end. The browser must allow concurrent queries.
+    BatchResearch(RelationshipBrowser &browser, const std::vector<std::string_view> &names, std::ostream &out)
+    {
+        // More blocks than threads so a block of busy people does not hold everyone up
+        const std::size_t blocks =
+            std::min<std::size_t>(names.size(), std::max(1u, std::thread::hardware_concurrency()) * 8);
+        std::vector<std::string> buffers(blocks);
+
+        parallelFor(
+            blocks,
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t b = first; b < last; ++b)
+                {
+                    std::string &buffer = buffers[b];
+                    for (std::size_t i = names.size() * b / blocks; i < names.size() * (b + 1) / blocks; ++i)
+                    {
+                        browser.forEachChildOf(names[i], [&](Person &child) {
+                            buffer.append(names[i]).append(" has a child called ").append(child.name).push_back('\n');
+                        });
+                    }
+                }
+            },
+            1);
+
+        for (auto &buffer : buffers)
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+        out.flush();
+    }
+};
+
+int main()
+{
+    // Create persons
+    Person parent{"John"};
+    Person child1{"Chris"};
+    Person child2{"Matt"};
+
+    Person parent2{"Greg"};
+    Person child3{"Dominic"};
+
+    // Create a Relationships object to store the relationships
+    Relationships relationships;
+    relationships.addParentAndChild(parent, child1);
+    relationships.addParentAndChild(parent, child2);
+    relationships.addParentAndChild(parent2, child3);
+
+    // Create an instance of the Research class using the Relationships object
+    Research exploreRelationships(relationships, "Greg");
+
+    // The same store keeping each pair once, with parents found through a reverse index
+    Relationships compact(StorageMode::singleEdge);
+    compact.addParentAndChild(parent2, child3);
+    for (auto *p : compact.findAllParentsOf("Dominic"))
+    {
+        std::cout << "Dominic has a parent called " << p->name << std::endl;
+    }
+
+    // The same research against the hash-indexed implementation
+    IndexedRelationships indexed;
+    indexed.addParentAndChild(parent, child1);
+    indexed.addParentAndChild(parent, child2);
+    indexed.addParentAndChild(parent2, child3);
+    Research exploreIndexed(indexed, "John");
+
+    // Names are copied into the index, so this one outlives the string it came from
+    {
+        std::string grandchild = "Anna";
+        indexed.addParentAndChild(child1, Person{grandchild});
+    }
+    Research exploreGrandchild(indexed, "Chris");
+
+    // A frozen compressed copy of the mutable store
+    RelationshipGraph graph = RelationshipGraph::build(relationships);
+    Research exploreGraph(graph, "Greg");
+    for (auto *descendant : graph.findAllDescendantsOf("John"))
+    {
+        std::cout << "John is an ancestor of " << descendant->name << std::endl;
+    }
+
+    for (auto *sibling : relationships.findAllSiblingsOf("Chris"))
+    {
+        std::cout << "Chris has a sibling called " << sibling->name << std::endl;
+    }
+
+    // A graph loaded straight from an edge list
+    RelationshipGraph loaded = loadEdgeList("# parent,child\nJohn,Chris\nJohn,Matt\nGreg\tDominic\n");
+    Research exploreLoaded(loaded, "John");
+
+    // A store that readers can query while a writer publishes batches
+    ConcurrentRelationships concurrent;
+    std::thread reader([&concurrent] {
+        while (concurrent.findAllChildrenOf("John").size() < 2)
+        {
+            std::this_thread::yield();
+        }
+    });
+    concurrent.addParentAndChild(parent, child1);
+    concurrent.addParentAndChild(parent, child2);
+    concurrent.publish();
+    reader.join();
+    Research exploreConcurrent(concurrent, "John");
+
+    // Repeated questions answered from a cache until the store changes
+    CachingRelationshipBrowser cache(indexed);
+    Research firstAsk(cache, "John");
+    Research secondAsk(cache, "John");
+    indexed.addParentAndChild(parent, Person{"Lucy"});
+    Research afterChange(cache, "John");
+    std::cout << "cache hit rate: " << cache.stats().hitRate() << std::endl;
+
+    // A store split into independently locked shards
+    PartitionedRelationships partitioned(4);
+    partitioned.addParentAndChild(parent, child1);
+    partitioned.addParentAndChild(child1, Person{"Anna"});
+    for (auto *descendant : partitioned.findAllDescendantsOf("John"))
+    {
+        std::cout << "John is an ancestor of " << descendant->name << std::endl;
+    }
+
+    // Many questions answered in one batch
+    BatchResearch batch(graph, {"John", "Greg"}, std::cout);
+
+    // The graph saved to disk and queried straight from the mapped file
+    std::string graphFile;
+    try
+    {
+        graphFile = (std::filesystem::temp_directory_path() / "family.graph").string();
+        writeRelationshipGraph(graph, graphFile);
+        MappedRelationshipGraph mapped(graphFile);
+        std::cout << "mapped graph file is " << (mapped.verify() ? "intact" : "damaged") << std::endl;
+        Research exploreMapped(mapped, "John");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "skipping the graph file: " << e.what() << std::endl;
+    }
+    if (!graphFile.empty())
+    {
+        std::remove(graphFile.c_str());
+    }
+
+    // Children written into a fixed buffer, without allocating
+    Person *buffer[4];
+    std::size_t count = graph.copyChildrenOf("John", buffer);
+    std::cout << "John has " << count << " children, the first is " << buffer[0]->name << std::endl;
+
+    // The shortest chain of links between two people of the frozen graph
+    if (auto path = graph.shortestPath("Chris", "Matt"))
+    {
+        std::cout << "Path from " << graph.person(path->people[0]).name << ":";
+        for (std::size_t i = 0; i < path->links.size(); ++i)
+        {
+            std::cout << (path->links[i] == Relationship::parent ? " parent " : " child ")
+                      << graph.person(path->people[i + 1]).name;
+        }
+        std::cout << std::endl;
+    }
+
+    // Kinship between two people of the frozen graph
+    KinshipIndex kinship(graph);
+    if (auto k = kinship.relate(*graph.idOf("Chris"), *graph.idOf("Matt")))
+    {
+        std::cout << "Chris and Matt descend from " << graph.person(k->ancestor).name << " ("
+                  << k->generationsFromA << " and " << k->generationsFromB << " generations)" << std::endl;
+    }
+
+    // Generations of the frozen graph, kept up to date as links are added
+    GenerationIndex generations(graph);
+    PersonId anna = static_cast<PersonId>(graph.size());
+    generations.addParentAndChild(*graph.idOf("Matt"), anna);
+    std::cout << "Matt's child is in generation " << *generations.generationOf(anna) << std::endl;
+    if (!generations.addParentAndChild(anna, *graph.idOf("John")))
+    {
+        std::cout << "a cycle of " << generations.findCycle().size() << " people was found" << std::endl;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -1,7 +1,37 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <variant>
 #include <vector>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // Objects in a program should be replaceable with instances of their subtypes
 // w/o altering the correctness of the program
 
@@ -48,6 +78,8 @@ class Rectangle
     {
     }
 
+    virtual ~Rectangle() = default;
+
     int get_width() const
     {
         return width;
@@ -89,6 +121,583 @@ class Square : public Rectangle
     }
 };
 
+// Runs f(begin, end) over [0, n) split into one contiguous chunk per hardware thread.
+// Small ranges are run on the calling thread.
+template <typename F> void parallel_for(std::size_t n, F f, std::size_t min_chunk = 1 << 14)
+{
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max<std::size_t>(1, n / min_chunk));
+    if (threads == 1)
+    {
+        f(std::size_t{0}, n);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t)
+        workers.emplace_back(f, n * t / threads, n * (t + 1) / threads);
+    for (auto &w : workers)
+        w.join();
+}
+
+enum class ShapeKind : std::uint8_t
+{
+    rectangle,
+    square
+};
+
+// Mutable view of a shape collection stored column by column. Bulk operations work on this view
+// so they apply equally to owned stores and to externally provided memory.
+struct ShapeColumns
+{
+    std::span<ShapeKind> kind;
+    std::span<int> width;
+    std::span<int> height;
+
+    std::size_t size() const
+    {
+        return kind.size();
+    }
+};
+
+// Structure-of-arrays store for many shapes: one column per attribute instead of one heap object
+// per shape, so a pass over all widths touches only widths and needs no virtual calls.
+class ShapeStore
+{
+    std::vector<ShapeKind> kinds;
+    std::vector<int> widths, heights;
+
+  public:
+    void reserve(std::size_t n)
+    {
+        kinds.reserve(n);
+        widths.reserve(n);
+        heights.reserve(n);
+    }
+
+    void add(const Rectangle &r)
+    {
+        bool square = dynamic_cast<const Square *>(&r) != nullptr;
+        kinds.push_back(square ? ShapeKind::square : ShapeKind::rectangle);
+        widths.push_back(r.get_width());
+        heights.push_back(r.get_height());
+    }
+
+    void add_rectangle(int width, int height)
+    {
+        kinds.push_back(ShapeKind::rectangle);
+        widths.push_back(width);
+        heights.push_back(height);
+    }
+
+    void add_square(int size)
+    {
+        kinds.push_back(ShapeKind::square);
+        widths.push_back(size);
+        heights.push_back(size);
+    }
+
+    std::size_t size() const
+    {
+        return kinds.size();
+    }
+
+    ShapeColumns columns()
+    {
+        return {kinds, widths, heights};
+    }
+};
+
+// Bulk versions of the Rectangle setters. Each takes an optional selection mask (one byte per
+// shape, non-zero = selected; empty = every shape; any other length throws std::invalid_argument)
+// and keeps width == height for squares by consulting the kind column instead of dispatching
+// through set_width/set_height. The loop bodies are branch-free selects so the compiler can
+// vectorize them, and the range is split across threads with parallel_for.
+namespace bulk
+{
+namespace detail
+{
+template <typename Op> void apply(ShapeColumns shapes, std::span<const std::uint8_t> selection, Op op)
+{
+    if (!selection.empty() && selection.size() != shapes.size())
+        throw std::invalid_argument("selection mask must match the number of shapes");
+    parallel_for(shapes.size(), [&](std::size_t begin, std::size_t end) {
+        ShapeKind *kind = shapes.kind.data();
+        int *width = shapes.width.data();
+        int *height = shapes.height.data();
+        if (selection.empty())
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                op(kind[i] == ShapeKind::square, true, width[i], height[i]);
+        }
+        else
+        {
+            const std::uint8_t *selected = selection.data();
+            for (std::size_t i = begin; i < end; ++i)
+                op(kind[i] == ShapeKind::square, selected[i] != 0, width[i], height[i]);
+        }
+    });
+}
+} // namespace detail
+
+inline void scale(ShapeColumns shapes, double factor, std::span<const std::uint8_t> selection = {})
+{
+    detail::apply(shapes, selection, [factor](bool, bool selected, int &w, int &h) {
+        w = selected ? static_cast<int>(w * factor) : w;
+        h = selected ? static_cast<int>(h * factor) : h;
+    });
+}
+
+inline void clamp(ShapeColumns shapes, int lo, int hi, std::span<const std::uint8_t> selection = {})
+{
+    detail::apply(shapes, selection, [lo, hi](bool, bool selected, int &w, int &h) {
+        w = selected ? std::clamp(w, lo, hi) : w;
+        h = selected ? std::clamp(h, lo, hi) : h;
+    });
+}
+
+inline void set_width(ShapeColumns shapes, int width, std::span<const std::uint8_t> selection = {})
+{
+    detail::apply(shapes, selection, [width](bool square, bool selected, int &w, int &h) {
+        w = selected ? width : w;
+        h = selected && square ? width : h;
+    });
+}
+
+inline void set_height(ShapeColumns shapes, int height, std::span<const std::uint8_t> selection = {})
+{
+    detail::apply(shapes, selection, [height](bool square, bool selected, int &w, int &h) {
+        h = selected ? height : h;
+        w = selected && square ? height : w;
+    });
+}
+} // namespace bulk
+
+// Summary of the areas in a shape collection. Histogram bucket b counts the areas in
+// [2^b, 2^(b+1)); bucket 0 also holds the empty (zero-area) shapes.
+struct AreaStatistics
+{
+    std::size_t count = 0;
+    std::int64_t sum = 0;
+    std::int64_t min = 0;
+    std::int64_t max = 0;
+    double mean = 0;
+    std::array<std::size_t, 64> histogram{};
+
+    std::int64_t median = 0; // estimated from a sample
+    std::int64_t p90 = 0;    // estimated from a sample
+    std::int64_t p99 = 0;    // estimated from a sample
+};
+
+// Computes AreaStatistics in parallel. The range is cut into a fixed number of blocks that
+// does not depend on the number of threads; each block produces a partial result and the
+// partials are merged in block order, so the output is identical on every machine. Percentiles
+// are read from an evenly strided sample of `sample_size` shapes (at least one) rather than a
+// full sort.
+inline AreaStatistics area_statistics(ShapeColumns shapes, std::size_t sample_size = 1 << 16)
+{
+    AreaStatistics stats;
+    const std::size_t n = shapes.size();
+    if (n == 0)
+        return stats;
+
+    constexpr std::size_t block_size = 1 << 16;
+    const std::size_t blocks = (n + block_size - 1) / block_size;
+    std::vector<AreaStatistics> partial(blocks);
+
+    parallel_for(
+        blocks,
+        [&](std::size_t first, std::size_t last) {
+            for (std::size_t b = first; b < last; ++b)
+            {
+                AreaStatistics &p = partial[b];
+                p.min = std::numeric_limits<std::int64_t>::max();
+                p.max = std::numeric_limits<std::int64_t>::min();
+                std::size_t end = std::min(n, (b + 1) * block_size);
+                for (std::size_t i = b * block_size; i < end; ++i)
+                {
+                    std::int64_t a = std::int64_t{shapes.width[i]} * shapes.height[i];
+                    p.sum += a;
+                    p.min = std::min(p.min, a);
+                    p.max = std::max(p.max, a);
+                    ++p.histogram[a > 1 ? std::bit_width(static_cast<std::uint64_t>(a)) - 1 : 0];
+                }
+                p.count = end - b * block_size;
+            }
+        },
+        1);
+
+    stats.min = std::numeric_limits<std::int64_t>::max();
+    stats.max = std::numeric_limits<std::int64_t>::min();
+    for (auto &p : partial)
+    {
+        stats.count += p.count;
+        stats.sum += p.sum;
+        stats.min = std::min(stats.min, p.min);
+        stats.max = std::max(stats.max, p.max);
+        for (std::size_t b = 0; b < stats.histogram.size(); ++b)
+            stats.histogram[b] += p.histogram[b];
+    }
+    stats.mean = static_cast<double>(stats.sum) / static_cast<double>(stats.count);
+
+    std::vector<std::int64_t> sample;
+    std::size_t step = std::max<std::size_t>(1, n / std::max<std::size_t>(1, sample_size));
+    for (std::size_t i = 0; i < n; i += step)
+        sample.push_back(std::int64_t{shapes.width[i]} * shapes.height[i]);
+    auto percentile = [&](double q) {
+        auto nth = sample.begin() + static_cast<std::ptrdiff_t>(q * static_cast<double>(sample.size() - 1));
+        std::nth_element(sample.begin(), nth, sample.end());
+        return *nth;
+    };
+    stats.median = percentile(0.5);
+    stats.p90 = percentile(0.9);
+    stats.p99 = percentile(0.99);
+    return stats;
+}
+
+// Binary columnar shape file: a fixed header followed by the kind, width, height and (optionally)
+// x and y columns, each starting on an 8-byte boundary. The columns have exactly the in-memory
+// layout of ShapeColumns, so a mapped file is used in place without parsing or copying.
+struct ShapeFileHeader
+{
+    char magic[4];         // "SHPS"
+    std::uint32_t version; // 1
+    std::uint64_t count;
+    std::uint32_t flags; // bit 0: x and y columns present
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(int) == 4 && sizeof(ShapeKind) == 1 && sizeof(ShapeFileHeader) == 24);
+
+constexpr std::uint32_t shape_file_has_position = 1;
+
+inline std::size_t shape_file_column_offset(std::uint64_t count, int column)
+{
+    auto align = [](std::size_t v) { return (v + 7) & ~std::size_t{7}; };
+    std::size_t offset = align(sizeof(ShapeFileHeader) + count); // kinds are the first column
+    return column == 0 ? sizeof(ShapeFileHeader) : offset + (column - 1) * align(count * sizeof(int));
+}
+
+// Writes shapes (and, if x and y are non-empty, their positions) to path.
+inline void write_shape_file(const std::string &path, ShapeColumns shapes, std::span<const int> x = {},
+                             std::span<const int> y = {})
+{
+    const std::uint64_t n = shapes.size();
+    const bool has_position = !x.empty();
+    if (has_position && (x.size() != n || y.size() != n))
+        throw std::invalid_argument("position columns must match the number of shapes");
+
+    ShapeFileHeader header{{'S', 'H', 'P', 'S'}, 1, n, has_position ? shape_file_has_position : 0, 0};
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    if (!out)
+        throw std::runtime_error("cannot open " + path);
+
+    auto put = [&](int column, const void *data, std::size_t bytes) {
+        out.seekp(static_cast<std::streamoff>(shape_file_column_offset(n, column)));
+        out.write(static_cast<const char *>(data), static_cast<std::streamsize>(bytes));
+    };
+    out.write(reinterpret_cast<const char *>(&header), sizeof header);
+    put(0, shapes.kind.data(), n);
+    put(1, shapes.width.data(), n * sizeof(int));
+    put(2, shapes.height.data(), n * sizeof(int));
+    if (has_position)
+    {
+        put(3, x.data(), n * sizeof(int));
+        put(4, y.data(), n * sizeof(int));
+    }
+    if (!out)
+        throw std::runtime_error("failed writing " + path);
+}
+
+// Maps a shape file into memory. The mapping is copy-on-write: the bulk operations can modify
+// columns() in place and the changes stay private to the process, never reaching the file.
+class MappedShapeFile
+{
+    std::byte *base = nullptr;
+    std::size_t length = 0;
+    ShapeFileHeader header{};
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+    template <typename T> std::span<T> column(int c) const
+    {
+        std::size_t count = header.count;
+        if (c >= 3 && !(header.flags & shape_file_has_position))
+            count = 0;
+        return {reinterpret_cast<T *>(base + shape_file_column_offset(header.count, c)), count};
+    }
+
+  public:
+    explicit MappedShapeFile(const std::string &path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("cannot open " + path);
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        length = static_cast<std::size_t>(size.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping)
+            base = static_cast<std::byte *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+        if (!base)
+        {
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("cannot map " + path);
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            length = static_cast<std::size_t>(st.st_size);
+            void *p = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            base = p == MAP_FAILED ? nullptr : static_cast<std::byte *>(p);
+        }
+        ::close(fd);
+        if (!base)
+            throw std::runtime_error("cannot map " + path);
+#endif
+        if (length >= sizeof header)
+            std::memcpy(&header, base, sizeof header);
+        bool has_position = header.flags & shape_file_has_position;
+        // Each shape needs at least a kind byte and two ints, so a larger count is corrupt; checking
+        // it first also keeps the offset arithmetic below from wrapping around.
+        if (length < sizeof header || std::memcmp(header.magic, "SHPS", 4) != 0 || header.version != 1 ||
+            header.count > length / (1 + 2 * sizeof(int)) ||
+            length < shape_file_column_offset(header.count, has_position ? 4 : 2) + header.count * sizeof(int))
+        {
+            release();
+            throw std::runtime_error(path + " is not a valid shape file");
+        }
+    }
+
+    MappedShapeFile(const MappedShapeFile &) = delete;
+    MappedShapeFile &operator=(const MappedShapeFile &) = delete;
+
+    ~MappedShapeFile()
+    {
+        release();
+    }
+
+    ShapeColumns columns() const
+    {
+        return {column<ShapeKind>(0), column<int>(1), column<int>(2)};
+    }
+
+    // Position columns; empty when the file was written without positions.
+    std::span<int> x() const
+    {
+        return column<int>(3);
+    }
+
+    std::span<int> y() const
+    {
+        return column<int>(4);
+    }
+
+  private:
+    void release()
+    {
+        if (!base)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        ::munmap(base, length);
+#endif
+        base = nullptr;
+    }
+};
+
+// Value counterparts of Rectangle and Square for shapes known at compile time. They have no
+// virtual functions and no setters, so a square can never be turned into a non-square, and
+// everything is constexpr: tables of them are computed by the compiler and can live in
+// read-only data.
+struct ConstRectangle
+{
+    int width, height;
+
+    constexpr ConstRectangle(int width, int height) : width{width}, height{height}
+    {
+    }
+
+    constexpr int area() const
+    {
+        return width * height;
+    }
+
+    constexpr ConstRectangle scaled(int factor) const
+    {
+        return {width * factor, height * factor};
+    }
+
+    constexpr ConstRectangle with_width(int w) const
+    {
+        return {w, height};
+    }
+
+    constexpr ConstRectangle with_height(int h) const
+    {
+        return {width, h};
+    }
+
+    Rectangle to_runtime() const
+    {
+        return Rectangle{width, height};
+    }
+};
+
+struct ConstSquare
+{
+    int size;
+
+    constexpr explicit ConstSquare(int size) : size{size}
+    {
+    }
+
+    constexpr int area() const
+    {
+        return size * size;
+    }
+
+    constexpr ConstSquare scaled(int factor) const
+    {
+        return ConstSquare{size * factor};
+    }
+
+    // Every square is a rectangle as a value; the conversion is one-way.
+    constexpr operator ConstRectangle() const
+    {
+        return {size, size};
+    }
+
+    Square to_runtime() const
+    {
+        return Square{size};
+    }
+};
+
+struct ConstShapeFactory
+{
+    static constexpr ConstRectangle create_rectangle(int w, int h)
+    {
+        return {w, h};
+    }
+
+    static constexpr ConstSquare create_square(int size)
+    {
+        return ConstSquare{size};
+    }
+};
+
+// Total area of a fixed layout, evaluated at compile time when the layout is constexpr.
+template <std::size_t N> constexpr int total_area(const ConstRectangle (&layout)[N])
+{
+    int sum = 0;
+    for (auto &r : layout)
+        sum += r.area();
+    return sum;
+}
+
+constexpr ConstRectangle standard_labels[] = {
+    ConstShapeFactory::create_rectangle(100, 50), ConstShapeFactory::create_rectangle(70, 35),
+    ConstShapeFactory::create_square(40), ConstShapeFactory::create_square(20).scaled(3)};
+
+static_assert(total_area(standard_labels) == 5000 + 2450 + 1600 + 3600);
+static_assert(ConstShapeFactory::create_square(5).scaled(2).area() == 100);
+
+// Shape collection that stores each kind in its own partition: squares keep a single size
+// column, rectangles keep width and height. A square-heavy collection needs about half the memory
+// of ShapeStore, and each partition is a plain array loop with no per-shape kind test.
+// Callers address shapes through handles and iterate through for_each, so the layout stays hidden.
+class CompactShapeStore
+{
+    std::vector<int> square_sizes;
+    std::vector<int> rectangle_widths, rectangle_heights;
+
+  public:
+    struct Handle
+    {
+        ShapeKind kind;
+        std::uint32_t index; // position inside the kind's partition
+    };
+
+    Handle add(const Rectangle &r)
+    {
+        if (dynamic_cast<const Square *>(&r) != nullptr)
+            return add_square(r.get_width());
+        return add_rectangle(r.get_width(), r.get_height());
+    }
+
+    Handle add_rectangle(int width, int height)
+    {
+        rectangle_widths.push_back(width);
+        rectangle_heights.push_back(height);
+        return {ShapeKind::rectangle, static_cast<std::uint32_t>(rectangle_widths.size() - 1)};
+    }
+
+    Handle add_square(int size)
+    {
+        square_sizes.push_back(size);
+        return {ShapeKind::square, static_cast<std::uint32_t>(square_sizes.size() - 1)};
+    }
+
+    ConstRectangle get(Handle h) const
+    {
+        if (h.kind == ShapeKind::square)
+            return ConstSquare{square_sizes[h.index]};
+        return {rectangle_widths[h.index], rectangle_heights[h.index]};
+    }
+
+    std::size_t size() const
+    {
+        return square_sizes.size() + rectangle_widths.size();
+    }
+
+    std::size_t memory_bytes() const
+    {
+        return (square_sizes.capacity() + rectangle_widths.capacity() + rectangle_heights.capacity()) * sizeof(int);
+    }
+
+    // Calls f(kind, width, height) for every shape: all squares first, then all rectangles.
+    template <typename F> void for_each(F f) const
+    {
+        for (int size : square_sizes)
+            f(ShapeKind::square, size, size);
+        for (std::size_t i = 0; i < rectangle_widths.size(); ++i)
+            f(ShapeKind::rectangle, rectangle_widths[i], rectangle_heights[i]);
+    }
+
+    std::int64_t total_area() const
+    {
+        std::int64_t sum = 0;
+        for (int size : square_sizes)
+            sum += std::int64_t{size} * size;
+        for (std::size_t i = 0; i < rectangle_widths.size(); ++i)
+            sum += std::int64_t{rectangle_widths[i]} * rectangle_heights[i];
+        return sum;
+    }
+
+    // Scales every shape; squares stay squares because they only have one size to scale.
+    void scale(int factor)
+    {
+        for (int &size : square_sizes)
+            size *= factor;
+        for (int &w : rectangle_widths)
+            w *= factor;
+        for (int &h : rectangle_heights)
+            h *= factor;
+    }
+};
+
 void process(Rectangle &r)
 {
     int w = r.get_width();
@@ -97,6 +706,853 @@ void process(Rectangle &r)
     std::cout << "expected area = " << (w * 10) << ", got " << r.area() << std::endl;
 }
 
+// process() above checks one expected area by hand. SubstitutabilityChecker does the same at
+// scale: every registered subtype is created from random dimensions and put through the
+// postconditions that code written against Rectangle relies on. Trials run in parallel, and each
+// failure is shrunk to the smallest dimensions that still break the same postcondition.
+class SubstitutabilityChecker
+{
+  public:
+    // Creates a shape of the subtype from two generated dimensions; subtypes with a single
+    // dimension ignore the second one.
+    using Factory = std::function<std::unique_ptr<Rectangle>(int, int)>;
+
+    enum class Property
+    {
+        set_width_keeps_height, // set_width(v): width becomes v, height is unchanged
+        set_height_keeps_width, // set_height(v): height becomes v, width is unchanged
+        set_width_sets_area,    // set_width(v): area() becomes v * the old height
+        set_height_sets_area,   // set_height(v): area() becomes the old width * v
+    };
+
+    struct Violation
+    {
+        std::string subtype;
+        Property property;
+        int a, b, value; // minimal counterexample: factory(a, b), then the setter with value
+        std::string detail;
+    };
+
+  private:
+    struct Subtype
+    {
+        std::string name;
+        Factory create;
+    };
+    std::vector<Subtype> subtypes;
+
+    // Returns an empty string when the property holds for factory(a, b) and value.
+    static std::string check(const Factory &create, Property property, int a, int b, int value)
+    {
+        auto shape = create(a, b);
+        int w = shape->get_width(), h = shape->get_height();
+        switch (property)
+        {
+        case Property::set_width_keeps_height:
+            shape->set_width(value);
+            if (shape->get_width() != value || shape->get_height() != h)
+                return "set_width(" + std::to_string(value) + ") on " + std::to_string(w) + "x" + std::to_string(h) +
+                       " gave " + std::to_string(shape->get_width()) + "x" + std::to_string(shape->get_height());
+            return {};
+        case Property::set_height_keeps_width:
+            shape->set_height(value);
+            if (shape->get_height() != value || shape->get_width() != w)
+                return "set_height(" + std::to_string(value) + ") on " + std::to_string(w) + "x" + std::to_string(h) +
+                       " gave " + std::to_string(shape->get_width()) + "x" + std::to_string(shape->get_height());
+            return {};
+        case Property::set_width_sets_area:
+            shape->set_width(value);
+            if (shape->area() != value * h)
+                return "area() after set_width(" + std::to_string(value) + ") on " + std::to_string(w) + "x" +
+                       std::to_string(h) + " is " + std::to_string(shape->area());
+            return {};
+        default:
+            shape->set_height(value);
+            if (shape->area() != w * value)
+                return "area() after set_height(" + std::to_string(value) + ") on " + std::to_string(w) + "x" +
+                       std::to_string(h) + " is " + std::to_string(shape->area());
+            return {};
+        }
+    }
+
+    // Greedily lowers each parameter (halving, then decrementing) while the property still fails.
+    static Violation shrink(const Subtype &subtype, Property property, int a, int b, int value)
+    {
+        std::array<int, 3> p{a, b, value};
+        for (bool progress = true; progress;)
+        {
+            progress = false;
+            for (int &x : p)
+            {
+                for (int candidate : {x / 2, x - 1})
+                {
+                    if (candidate < 1 || candidate >= x)
+                        continue;
+                    int saved = x;
+                    x = candidate;
+                    if (!check(subtype.create, property, p[0], p[1], p[2]).empty())
+                    {
+                        progress = true;
+                        break;
+                    }
+                    x = saved;
+                }
+            }
+        }
+        return {subtype.name, property, p[0], p[1], p[2], check(subtype.create, property, p[0], p[1], p[2])};
+    }
+
+  public:
+    void add_subtype(std::string name, Factory create)
+    {
+        subtypes.push_back({std::move(name), std::move(create)});
+    }
+
+    // Runs `trials` random cases per subtype and returns one shrunk violation per
+    // (subtype, property) pair that failed, in registration order.
+    std::vector<Violation> run(std::size_t trials, int max_dimension = 1000, std::uint64_t seed = 1) const
+    {
+        constexpr Property properties[] = {Property::set_width_keeps_height, Property::set_height_keeps_width,
+                                           Property::set_width_sets_area, Property::set_height_sets_area};
+        constexpr std::size_t property_count = std::size(properties);
+
+        // First failing case found per (subtype, property); the lowest trial index wins so the
+        // report does not depend on thread scheduling.
+        struct Failure
+        {
+            std::size_t trial = std::numeric_limits<std::size_t>::max();
+            int a = 0, b = 0, value = 0;
+        };
+        std::vector<Failure> failures(subtypes.size() * property_count);
+        std::mutex lock;
+
+        // Trials are generated in fixed-size blocks, each with its own seed, so the cases do not
+        // depend on how many threads share the work.
+        constexpr std::size_t block_size = 1 << 12;
+        const std::size_t blocks = (trials + block_size - 1) / block_size;
+
+        for (std::size_t s = 0; s < subtypes.size(); ++s)
+        {
+            parallel_for(
+                blocks,
+                [&, s](std::size_t first_block, std::size_t last_block) {
+                    std::array<Failure, property_count> local{};
+                    for (std::size_t block = first_block; block < last_block; ++block)
+                    {
+                        std::mt19937_64 rng{seed + block};
+                        std::uniform_int_distribution<int> dimension{1, max_dimension};
+                        for (std::size_t t = block * block_size; t < std::min(trials, (block + 1) * block_size); ++t)
+                        {
+                            int a = dimension(rng), b = dimension(rng), value = dimension(rng);
+                            for (std::size_t p = 0; p < property_count; ++p)
+                            {
+                                if (local[p].trial < t ||
+                                    check(subtypes[s].create, properties[p], a, b, value).empty())
+                                    continue;
+                                local[p] = {t, a, b, value};
+                            }
+                        }
+                    }
+
+                    std::lock_guard guard{lock};
+                    for (std::size_t p = 0; p < property_count; ++p)
+                    {
+                        Failure &f = failures[s * property_count + p];
+                        if (local[p].trial < f.trial)
+                            f = local[p];
+                    }
+                },
+                1);
+        }
+
+        std::vector<Violation> violations;
+        for (std::size_t i = 0; i < failures.size(); ++i)
+        {
+            auto &f = failures[i];
+            if (f.trial != std::numeric_limits<std::size_t>::max())
+                violations.push_back(
+                    shrink(subtypes[i / property_count], properties[i % property_count], f.a, f.b, f.value));
+        }
+        return violations;
+    }
+};
+
+// A rectangle placed on a plane, with (x, y) its lower-left corner. Rectangle itself has no
+// position, so layouts carry the placement next to the dimensions.
+struct PlacedRectangle
+{
+    int x, y, width, height;
+
+    static PlacedRectangle at(int x, int y, const Rectangle &r)
+    {
+        return {x, y, r.get_width(), r.get_height()};
+    }
+};
+
+// Summing Rectangle::area over overlapping rectangles counts the shared parts more than once.
+// UnionArea sweeps a vertical line from left to right over the rectangle edges and keeps the
+// covered length of the line in a segment tree over the compressed y coordinates, giving the
+// exact covered area in O(n log n).
+class UnionArea
+{
+    struct Event
+    {
+        int x;
+        int y1, y2;
+        int delta; // +1 on the left edge, -1 on the right edge
+    };
+
+    std::vector<int> ys;
+    std::vector<int> count;          // how many rectangles fully cover each node's range
+    std::vector<std::int64_t> length; // covered length inside each node's range
+
+    void update(int node, int lo, int hi, int y1, int y2, int delta)
+    {
+        if (y2 <= ys[lo] || ys[hi] <= y1)
+            return;
+        if (y1 <= ys[lo] && ys[hi] <= y2)
+        {
+            count[node] += delta;
+        }
+        else
+        {
+            int mid = (lo + hi) / 2;
+            update(2 * node, lo, mid, y1, y2, delta);
+            update(2 * node + 1, mid, hi, y1, y2, delta);
+        }
+
+        if (count[node] > 0)
+            length[node] = std::int64_t{ys[hi]} - ys[lo];
+        else if (hi - lo == 1)
+            length[node] = 0;
+        else
+            length[node] = length[2 * node] + length[2 * node + 1];
+    }
+
+  public:
+    // Covered area of the union of the rectangles. Empty rectangles are ignored.
+    std::int64_t of(const std::vector<PlacedRectangle> &rects)
+    {
+        std::vector<Event> events;
+        events.reserve(rects.size() * 2);
+        ys.clear();
+        ys.reserve(rects.size() * 2);
+
+        for (auto &r : rects)
+        {
+            if (r.width <= 0 || r.height <= 0)
+                continue;
+            events.push_back({r.x, r.y, r.y + r.height, +1});
+            events.push_back({r.x + r.width, r.y, r.y + r.height, -1});
+            ys.push_back(r.y);
+            ys.push_back(r.y + r.height);
+        }
+        if (events.empty())
+            return 0;
+
+        std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.x < b.x; });
+        std::sort(ys.begin(), ys.end());
+        ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+        if (ys.size() < 2)
+            return 0;
+
+        count.assign(4 * ys.size(), 0);
+        length.assign(4 * ys.size(), 0);
+
+        std::int64_t area = 0;
+        int last_x = events.front().x;
+        for (auto &e : events)
+        {
+            area += length[1] * (std::int64_t{e.x} - last_x);
+            update(1, 0, static_cast<int>(ys.size()) - 1, e.y1, e.y2, e.delta);
+            last_x = e.x;
+        }
+        return area;
+    }
+
+    // Same result as of(), but the x axis is cut into one slab per thread. Every thread clips the
+    // rectangles to its slab and sweeps it independently; the slab areas add up to the union.
+    static std::int64_t of_parallel(const std::vector<PlacedRectangle> &rects,
+                                    unsigned threads = std::thread::hardware_concurrency())
+    {
+        if (threads <= 1 || rects.size() < 2 * threads)
+            return UnionArea{}.of(rects);
+
+        // Slab boundaries at the quantiles of the left edges keep the slabs similarly loaded.
+        std::vector<int> xs;
+        xs.reserve(rects.size());
+        for (auto &r : rects)
+            xs.push_back(r.x);
+        std::vector<int> cuts;
+        for (unsigned t = 1; t < threads; ++t)
+        {
+            auto nth = xs.begin() + xs.size() * t / threads;
+            std::nth_element(xs.begin(), nth, xs.end());
+            cuts.push_back(*nth);
+        }
+        std::sort(cuts.begin(), cuts.end());
+        cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+        std::vector<std::int64_t> partial(cuts.size() + 1, 0);
+        std::vector<std::thread> workers;
+        for (std::size_t s = 0; s <= cuts.size(); ++s)
+        {
+            workers.emplace_back([&, s] {
+                int lo = s == 0 ? std::numeric_limits<int>::min() : cuts[s - 1];
+                int hi = s == cuts.size() ? std::numeric_limits<int>::max() : cuts[s];
+                std::vector<PlacedRectangle> clipped;
+                for (auto &r : rects)
+                {
+                    int x1 = std::max(r.x, lo);
+                    int x2 = std::min(r.x + r.width, hi);
+                    if (x1 < x2)
+                        clipped.push_back({x1, r.y, x2 - x1, r.height});
+                }
+                partial[s] = UnionArea{}.of(clipped);
+            });
+        }
+        for (auto &w : workers)
+            w.join();
+
+        std::int64_t area = 0;
+        for (auto a : partial)
+            area += a;
+        return area;
+    }
+
+    // Rasterises the rectangles onto a width x height canvas of unit cells and returns, row by row,
+    // how many rectangles cover each cell (0 means uncovered). A 2D difference array makes this
+    // O(n + width * height) no matter how large the rectangles are.
+    static std::vector<int> coverage_mask(const std::vector<PlacedRectangle> &rects, int width, int height)
+    {
+        std::vector<int> diff(static_cast<std::size_t>(width + 1) * (height + 1), 0);
+        auto at = [&](int x, int y) -> int & { return diff[static_cast<std::size_t>(y) * (width + 1) + x]; };
+
+        for (auto &r : rects)
+        {
+            int x1 = std::clamp(r.x, 0, width), x2 = std::clamp(r.x + r.width, 0, width);
+            int y1 = std::clamp(r.y, 0, height), y2 = std::clamp(r.y + r.height, 0, height);
+            if (x1 >= x2 || y1 >= y2)
+                continue;
+            at(x1, y1) += 1;
+            at(x2, y1) -= 1;
+            at(x1, y2) -= 1;
+            at(x2, y2) += 1;
+        }
+
+        std::vector<int> mask(static_cast<std::size_t>(width) * height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                if (x > 0)
+                    at(x, y) += at(x - 1, y);
+                if (y > 0)
+                    at(x, y) += at(x, y - 1);
+                if (x > 0 && y > 0)
+                    at(x, y) -= at(x - 1, y - 1);
+                mask[static_cast<std::size_t>(y) * width + x] = at(x, y);
+            }
+        }
+        return mask;
+    }
+};
+
+// Offline packing of labels onto fixed-size sheets. The labels are sorted by decreasing height
+// (then width) and placed into the current sheet; when a label does not fit, the sheet is closed
+// and a fresh one is opened. Each heuristic keeps its own free-space structure per sheet.
+enum class PackingHeuristic
+{
+    skyline,   // bottom-left placement on a skyline of horizontal segments
+    maxrects,  // best-short-side fit over maximal free rectangles
+    guillotine // best-area fit over free rectangles split by guillotine cuts
+};
+
+struct Packing
+{
+    std::vector<int> sheet;                   // sheet of each label, -1 if larger than a sheet
+    std::vector<PlacedRectangle> placements; // position of each label on its sheet
+    int sheets = 0;
+    double utilization = 0; // packed area / total area of the used sheets
+};
+
+class SheetPacker
+{
+    struct Segment
+    {
+        int x, y, width;
+    };
+
+    int sheet_width, sheet_height;
+    PackingHeuristic heuristic;
+
+    std::vector<Segment> skyline;
+    std::vector<PlacedRectangle> free_rects;
+
+    void open_sheet()
+    {
+        skyline.assign(1, {0, 0, sheet_width});
+        free_rects.assign(1, {0, 0, sheet_width, sheet_height});
+    }
+
+    bool place_skyline(int w, int h, PlacedRectangle &out)
+    {
+        int best = -1, best_y = sheet_height, best_x = sheet_width;
+        for (std::size_t i = 0; i < skyline.size(); ++i)
+        {
+            int x = skyline[i].x;
+            if (x + w > sheet_width)
+                break;
+            int y = 0, covered = 0;
+            for (std::size_t j = i; j < skyline.size() && covered < w; ++j)
+            {
+                y = std::max(y, skyline[j].y);
+                covered += skyline[j].width;
+            }
+            if (y + h <= sheet_height && (y < best_y || (y == best_y && x < best_x)))
+            {
+                best = static_cast<int>(i);
+                best_y = y;
+                best_x = x;
+            }
+        }
+        if (best < 0)
+            return false;
+
+        out = {best_x, best_y, w, h};
+
+        // Raise the skyline under the new label, trimming or dropping the segments it covers.
+        std::size_t i = best;
+        int right = best_x + w;
+        while (i < skyline.size() && skyline[i].x < right)
+        {
+            int end = skyline[i].x + skyline[i].width;
+            if (end <= right)
+            {
+                skyline.erase(skyline.begin() + i);
+            }
+            else
+            {
+                skyline[i].width = end - right;
+                skyline[i].x = right;
+                break;
+            }
+        }
+        skyline.insert(skyline.begin() + best, {best_x, best_y + h, w});
+
+        // Merge neighbours at the same height so the skyline stays short.
+        for (std::size_t j = 0; j + 1 < skyline.size();)
+        {
+            if (skyline[j].y == skyline[j + 1].y)
+            {
+                skyline[j].width += skyline[j + 1].width;
+                skyline.erase(skyline.begin() + j + 1);
+            }
+            else
+            {
+                ++j;
+            }
+        }
+        return true;
+    }
+
+    static bool contains(const PlacedRectangle &a, const PlacedRectangle &b)
+    {
+        return b.x >= a.x && b.y >= a.y && b.x + b.width <= a.x + a.width && b.y + b.height <= a.y + a.height;
+    }
+
+    bool place_maxrects(int w, int h, PlacedRectangle &out)
+    {
+        int best = -1, best_short = std::numeric_limits<int>::max(), best_long = best_short;
+        for (std::size_t i = 0; i < free_rects.size(); ++i)
+        {
+            auto &f = free_rects[i];
+            if (f.width < w || f.height < h)
+                continue;
+            int short_side = std::min(f.width - w, f.height - h);
+            int long_side = std::max(f.width - w, f.height - h);
+            if (short_side < best_short || (short_side == best_short && long_side < best_long))
+            {
+                best = static_cast<int>(i);
+                best_short = short_side;
+                best_long = long_side;
+            }
+        }
+        if (best < 0)
+            return false;
+
+        out = {free_rects[best].x, free_rects[best].y, w, h};
+
+        // Every free rectangle overlapping the label is replaced by up to four maximal pieces.
+        std::vector<PlacedRectangle> next;
+        next.reserve(free_rects.size() + 4);
+        for (auto &f : free_rects)
+        {
+            if (out.x >= f.x + f.width || out.x + w <= f.x || out.y >= f.y + f.height || out.y + h <= f.y)
+            {
+                next.push_back(f);
+                continue;
+            }
+            if (out.x > f.x)
+                next.push_back({f.x, f.y, out.x - f.x, f.height});
+            if (out.x + w < f.x + f.width)
+                next.push_back({out.x + w, f.y, f.x + f.width - out.x - w, f.height});
+            if (out.y > f.y)
+                next.push_back({f.x, f.y, f.width, out.y - f.y});
+            if (out.y + h < f.y + f.height)
+                next.push_back({f.x, out.y + h, f.width, f.y + f.height - out.y - h});
+        }
+
+        // Drop free rectangles contained in another one.
+        free_rects.clear();
+        for (std::size_t i = 0; i < next.size(); ++i)
+        {
+            bool redundant = false;
+            for (std::size_t j = 0; j < next.size() && !redundant; ++j)
+                redundant = i != j && contains(next[j], next[i]) && (!contains(next[i], next[j]) || j < i);
+            if (!redundant)
+                free_rects.push_back(next[i]);
+        }
+        return true;
+    }
+
+    bool place_guillotine(int w, int h, PlacedRectangle &out)
+    {
+        int best = -1;
+        long long best_area = std::numeric_limits<long long>::max();
+        for (std::size_t i = 0; i < free_rects.size(); ++i)
+        {
+            auto &f = free_rects[i];
+            long long a = static_cast<long long>(f.width) * f.height;
+            if (f.width >= w && f.height >= h && a < best_area)
+            {
+                best = static_cast<int>(i);
+                best_area = a;
+            }
+        }
+        if (best < 0)
+            return false;
+
+        PlacedRectangle f = free_rects[best];
+        free_rects[best] = free_rects.back();
+        free_rects.pop_back();
+        out = {f.x, f.y, w, h};
+
+        // Cut along the shorter leftover axis so the larger remainder stays in one piece.
+        int right = f.width - w, top = f.height - h;
+        if (right < top)
+        {
+            if (right > 0)
+                free_rects.push_back({f.x + w, f.y, right, h});
+            if (top > 0)
+                free_rects.push_back({f.x, f.y + h, f.width, top});
+        }
+        else
+        {
+            if (right > 0)
+                free_rects.push_back({f.x + w, f.y, right, f.height});
+            if (top > 0)
+                free_rects.push_back({f.x, f.y + h, w, top});
+        }
+        return true;
+    }
+
+    bool place(int w, int h, PlacedRectangle &out)
+    {
+        switch (heuristic)
+        {
+        case PackingHeuristic::skyline:
+            return place_skyline(w, h, out);
+        case PackingHeuristic::maxrects:
+            return place_maxrects(w, h, out);
+        default:
+            return place_guillotine(w, h, out);
+        }
+    }
+
+  public:
+    SheetPacker(int sheet_width, int sheet_height, PackingHeuristic heuristic)
+        : sheet_width{sheet_width}, sheet_height{sheet_height}, heuristic{heuristic}
+    {
+    }
+
+    Packing pack(const std::vector<Rectangle> &labels)
+    {
+        Packing result;
+        result.sheet.assign(labels.size(), -1);
+        result.placements.assign(labels.size(), {0, 0, 0, 0});
+
+        std::vector<std::size_t> order(labels.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (labels[a].get_height() != labels[b].get_height())
+                return labels[a].get_height() > labels[b].get_height();
+            return labels[a].get_width() > labels[b].get_width();
+        });
+
+        long long packed = 0;
+        for (auto i : order)
+        {
+            int w = labels[i].get_width(), h = labels[i].get_height();
+            if (w <= 0 || h <= 0 || w > sheet_width || h > sheet_height)
+                continue;
+            if (result.sheets == 0 || !place(w, h, result.placements[i]))
+            {
+                open_sheet();
+                ++result.sheets;
+                place(w, h, result.placements[i]);
+            }
+            result.sheet[i] = result.sheets - 1;
+            packed += static_cast<long long>(w) * h;
+        }
+
+        if (result.sheets > 0)
+            result.utilization =
+                static_cast<double>(packed) / (static_cast<double>(sheet_width) * sheet_height * result.sheets);
+        return result;
+    }
+};
+
+// Packs `count` random labels (a quarter of them squares) with every heuristic and prints
+// the time taken, the number of sheets and their utilization.
+void benchmark_packing(std::size_t count)
+{
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> side{5, 120};
+    std::vector<Rectangle> labels;
+    labels.reserve(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (i % 4 == 0)
+            labels.push_back(Square{side(rng)});
+        else
+            labels.push_back(Rectangle{side(rng), side(rng)});
+    }
+
+    const std::pair<PackingHeuristic, const char *> heuristics[] = {
+        {PackingHeuristic::skyline, "skyline"},
+        {PackingHeuristic::maxrects, "maxrects"},
+        {PackingHeuristic::guillotine, "guillotine"}};
+    for (auto &[heuristic, name] : heuristics)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Packing p = SheetPacker{1000, 1000, heuristic}.pack(labels);
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << count << " labels on " << p.sheets << " sheets, utilization "
+                  << p.utilization * 100 << "%, " << ms << " ms" << std::endl;
+    }
+}
+
+// Every allocation made by the program goes through these replacements so the benchmarks can
+// report how many allocations each representation needs.
+std::atomic<std::size_t> allocation_count{0};
+
+void *operator new(std::size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+// GCC cannot see that the replaced operator new is the one paired with these deletes.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+using VariantShape = std::variant<ConstRectangle, ConstSquare>;
+
+// Compares the shape representations in this file on building a collection, summing areas,
+// setting every height (squares keep their invariant) and counting the shapes that intersect a
+// query window. Sizes grow tenfold from 1e3 up to max_size; results are written to out as a JSON
+// array with the time per shape and the allocations made by each run.
+void run_benchmarks(std::size_t max_size, std::ostream &out)
+{
+    constexpr int world = 10000;
+    constexpr PlacedRectangle window{2500, 2500, 5000, 5000};
+    auto hits = [&](int x, int y, int w, int h) {
+        return x < window.x + window.width && window.x < x + w && y < window.y + window.height && window.y < y + h;
+    };
+
+    bool first = true;
+    out << "[\n";
+    for (std::size_t n = 1000; n <= max_size; n *= 10)
+    {
+        // Shared input: every fourth shape is a square.
+        std::mt19937 rng{7};
+        std::uniform_int_distribution<int> side{1, 100}, coordinate{0, world};
+        std::vector<int> a(n), b(n), xs(n), ys(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            a[i] = side(rng);
+            b[i] = i % 4 == 0 ? a[i] : side(rng);
+            xs[i] = coordinate(rng);
+            ys[i] = coordinate(rng);
+        }
+
+        auto measure = [&](const char *representation, const char *operation, auto &&body) {
+            std::size_t allocations_before = allocation_count.load();
+            auto start = std::chrono::steady_clock::now();
+            std::int64_t checksum = body();
+            auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            std::size_t allocations = allocation_count.load() - allocations_before;
+            out << (first ? "" : ",\n") << "  {\"representation\": \"" << representation << "\", \"operation\": \""
+                << operation << "\", \"size\": " << n << ", \"ns_per_shape\": " << ns / static_cast<double>(n)
+                << ", \"allocations\": " << allocations << ", \"checksum\": " << checksum << "}";
+            first = false;
+        };
+
+        {
+            std::vector<std::unique_ptr<Rectangle>> shapes;
+            measure("virtual", "build", [&] {
+                shapes.reserve(n);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (i % 4 == 0)
+                        shapes.push_back(std::make_unique<Square>(a[i]));
+                    else
+                        shapes.push_back(std::make_unique<Rectangle>(a[i], b[i]));
+                }
+                return std::int64_t(shapes.size());
+            });
+            measure("virtual", "area", [&] {
+                std::int64_t sum = 0;
+                for (auto &s : shapes)
+                    sum += s->area();
+                return sum;
+            });
+            measure("virtual", "set_height", [&] {
+                for (auto &s : shapes)
+                    s->set_height(10);
+                return std::int64_t(shapes.back()->area());
+            });
+            measure("virtual", "window_query", [&] {
+                std::int64_t count = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    count += hits(xs[i], ys[i], shapes[i]->get_width(), shapes[i]->get_height());
+                return count;
+            });
+        }
+
+        {
+            std::vector<VariantShape> shapes;
+            measure("variant", "build", [&] {
+                shapes.reserve(n);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (i % 4 == 0)
+                        shapes.emplace_back(ConstSquare{a[i]});
+                    else
+                        shapes.emplace_back(ConstRectangle{a[i], b[i]});
+                }
+                return std::int64_t(shapes.size());
+            });
+            measure("variant", "area", [&] {
+                std::int64_t sum = 0;
+                for (auto &s : shapes)
+                    sum += std::visit([](auto &v) { return v.area(); }, s);
+                return sum;
+            });
+            measure("variant", "set_height", [&] {
+                for (auto &s : shapes)
+                {
+                    if (auto *sq = std::get_if<ConstSquare>(&s))
+                        *sq = ConstSquare{10};
+                    else
+                        s = std::get<ConstRectangle>(s).with_height(10);
+                }
+                return std::int64_t(std::visit([](auto &v) { return v.area(); }, shapes.back()));
+            });
+            measure("variant", "window_query", [&] {
+                std::int64_t count = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    ConstRectangle r = std::visit([](auto &v) { return ConstRectangle(v); }, shapes[i]);
+                    count += hits(xs[i], ys[i], r.width, r.height);
+                }
+                return count;
+            });
+        }
+
+        {
+            ShapeStore store;
+            measure("soa", "build", [&] {
+                store.reserve(n);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    if (i % 4 == 0)
+                        store.add_square(a[i]);
+                    else
+                        store.add_rectangle(a[i], b[i]);
+                }
+                return std::int64_t(store.size());
+            });
+            measure("soa", "area", [&] {
+                auto shapes = store.columns();
+                std::int64_t sum = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    sum += std::int64_t{shapes.width[i]} * shapes.height[i];
+                return sum;
+            });
+            measure("soa", "set_height", [&] {
+                bulk::set_height(store.columns(), 10);
+                return std::int64_t{store.columns().width[n - 1]} * store.columns().height[n - 1];
+            });
+            measure("soa", "window_query", [&] {
+                auto shapes = store.columns();
+                std::int64_t count = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    count += hits(xs[i], ys[i], shapes.width[i], shapes.height[i]);
+                return count;
+            });
+        }
+
+        {
+            std::vector<ConstRectangle> shapes;
+            measure("constexpr_value", "build", [&] {
+                shapes.reserve(n);
+                for (std::size_t i = 0; i < n; ++i)
+                    shapes.push_back(i % 4 == 0 ? ConstRectangle(ConstShapeFactory::create_square(a[i]))
+                                                : ConstShapeFactory::create_rectangle(a[i], b[i]));
+                return std::int64_t(shapes.size());
+            });
+            measure("constexpr_value", "area", [&] {
+                std::int64_t sum = 0;
+                for (auto &s : shapes)
+                    sum += s.area();
+                return sum;
+            });
+            measure("constexpr_value", "set_height", [&] {
+                for (std::size_t i = 0; i < n; ++i)
+                    shapes[i] = i % 4 == 0 ? ConstRectangle(ConstSquare{10}) : shapes[i].with_height(10);
+                return std::int64_t(shapes.back().area());
+            });
+            measure("constexpr_value", "window_query", [&] {
+                std::int64_t count = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    count += hits(xs[i], ys[i], shapes[i].width, shapes[i].height);
+                return count;
+            });
+        }
+    }
+    out << "\n]" << std::endl;
+}
+
 // To do !!
 struct RectangleFactory
 {
@@ -104,13 +1560,75 @@ struct RectangleFactory
     static Rectangle create_square(int size);
 };
 
-int main()
+int main(int argc, char *argv[])
 {
+    if (argc > 1 && std::string{argv[1]} == "--bench-packing")
+    {
+        benchmark_packing(argc > 2 ? std::stoul(argv[2]) : 100000);
+        return 0;
+    }
+    if (argc > 1 && std::string{argv[1]} == "--bench")
+    {
+        run_benchmarks(argc > 2 ? std::stoull(argv[2]) : 1000000, std::cout);
+        return 0;
+    }
+
     Rectangle r{3, 4};
     process(r);
 
     Square sq{5};
     process(sq);
 
+    std::vector<PlacedRectangle> layout{PlacedRectangle::at(0, 0, r), PlacedRectangle::at(2, 2, sq)};
+    std::cout << "sum of areas = " << (r.area() + sq.area()) << ", union area = " << UnionArea{}.of(layout)
+              << std::endl;
+
+    constexpr auto label = ConstShapeFactory::create_rectangle(3, 4).with_height(10);
+    Rectangle from_table = standard_labels[2].to_runtime();
+    std::cout << "compile-time label area = " << label.area() << ", standard labels cover "
+              << total_area(standard_labels) << ", table square area = " << from_table.area() << std::endl;
+
+    ShapeStore store;
+    store.add(Rectangle{3, 4});
+    store.add(Square{5});
+    bulk::set_height(store.columns(), 10);
+    auto shapes = store.columns();
+    for (std::size_t i = 0; i < shapes.size(); ++i)
+        std::cout << "bulk set_height: " << shapes.width[i] << " x " << shapes.height[i] << std::endl;
+
+    auto stats = area_statistics(store.columns());
+    std::cout << "area statistics: sum " << stats.sum << ", min " << stats.min << ", max " << stats.max
+              << ", mean " << stats.mean << ", median " << stats.median << std::endl;
+
+    std::string shape_file;
+    try
+    {
+        shape_file = (std::filesystem::temp_directory_path() / "shapes.bin").string();
+        write_shape_file(shape_file, store.columns());
+        MappedShapeFile mapped{shape_file};
+        std::cout << "mapped " << mapped.columns().size() << " shapes, total area "
+                  << area_statistics(mapped.columns()).sum << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "skipping the shape file: " << e.what() << std::endl;
+    }
+    if (!shape_file.empty())
+        std::remove(shape_file.c_str());
+
+    CompactShapeStore compact;
+    compact.add(Rectangle{3, 4});
+    auto square = compact.add(Square{5});
+    compact.scale(2);
+    std::cout << "compact store: " << compact.size() << " shapes, total area " << compact.total_area()
+              << ", scaled square " << compact.get(square).width << " x " << compact.get(square).height
+              << std::endl;
+
+    SubstitutabilityChecker checker;
+    checker.add_subtype("Rectangle", [](int a, int b) { return std::make_unique<Rectangle>(a, b); });
+    checker.add_subtype("Square", [](int a, int) { return std::make_unique<Square>(a); });
+    for (auto &v : checker.run(100000))
+        std::cout << v.subtype << " is not substitutable for Rectangle: " << v.detail << std::endl;
+
     return 0;
 }
\ No newline at end of file